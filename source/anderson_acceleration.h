@@ -0,0 +1,204 @@
+#ifndef _anderson_acceleration_h_
+#define _anderson_acceleration_h_
+
+#include <deque>
+#include <vector>
+
+#include <deal.II/lac/vector.h>
+#include <deal.II/lac/full_matrix.h>
+
+namespace NonlinearSolvers
+{
+    using namespace dealii;
+
+    /*!
+    @brief Anderson acceleration of a fixed point iteration $w_{k+1} = G(w_k)$.
+
+    @detail
+
+        This follows Walker and Ni 2011. With the fixed point residuals $f_k = G(w_k) - w_k$,
+        the accelerated iterate is
+
+            $w_{k+1} = G(w_k) - \sum_i \gamma_i (G(w_{i+1}) - G(w_i))$,
+
+        where $\gamma$ minimizes $|| f_k - \sum_i \gamma_i (f_{i+1} - f_i) ||$
+        over the last depth differences.
+
+        The small least squares problem is solved with a QR factorization of the differences,
+        which drops the differences that are nearly linearly dependent on the others,
+        e.g. once the iteration stalls or has converged. If all are dropped, then the iterate is not accelerated.
+    */
+    class AndersonAcceleration
+    {
+    public:
+
+        AndersonAcceleration(const unsigned int _depth = 0)
+            :
+            depth(_depth),
+            has_old_iterate(false)
+        {}
+
+        /*! Forget the history, e.g. before solving a new nonlinear problem */
+        void clear()
+        {
+            this->delta_f.clear();
+
+            this->delta_g.clear();
+
+            this->has_old_iterate = false;
+        }
+
+        /*! Overwrite the fixed point image g = G(w) of the iterate w with the accelerated iterate */
+        void accelerate(const Vector<double> &w, Vector<double> &g)
+        {
+            if (this->depth == 0)
+            {
+                return;
+            }
+
+            Vector<double> f(g);
+
+            f -= w;
+
+            this->accelerate_with_residual(f, g);
+        }
+
+        /*! As accelerate, but given the correction g = w - correction, so that w need not be stored */
+        void accelerate_correction(const Vector<double> &correction, Vector<double> &g)
+        {
+            if (this->depth == 0)
+            {
+                return;
+            }
+
+            Vector<double> f(correction);
+
+            f *= -1.;
+
+            this->accelerate_with_residual(f, g);
+        }
+
+    private:
+
+        /*! Accelerate given the fixed point residual f = G(w) - w */
+        void accelerate_with_residual(const Vector<double> &f, Vector<double> &g)
+        {
+            if (this->has_old_iterate)
+            {
+                this->delta_f.push_back(f);
+
+                this->delta_f.back() -= this->old_f;
+
+                this->delta_g.push_back(g);
+
+                this->delta_g.back() -= this->old_g;
+
+                if (this->delta_f.size() > this->depth)
+                {
+                    this->delta_f.pop_front();
+
+                    this->delta_g.pop_front();
+                }
+            }
+
+            this->old_f = f;
+
+            this->old_g = g;
+
+            this->has_old_iterate = true;
+
+            const unsigned int m = this->delta_f.size();
+
+            if (m == 0)
+            {
+                return;
+            }
+
+            /* Solve the least squares problem with the QR factorization of the differences by modified Gram-Schmidt.
+            A difference which is nearly linearly dependent on the previous differences, e.g. zero once the iteration stalls,
+            is dropped, so that R is never singular. */
+            const double drop_tolerance = 1.e-8;
+
+            std::vector<Vector<double>> q;
+
+            std::vector<unsigned int> columns;
+
+            FullMatrix<double> R(m, m);
+
+            for (unsigned int i = 0; i < m; ++i)
+            {
+                Vector<double> v(this->delta_f[i]);
+
+                const double norm = v.l2_norm();
+
+                std::vector<double> r(q.size());
+
+                for (unsigned int j = 0; j < q.size(); ++j)
+                {
+                    r[j] = q[j]*v;
+
+                    v.add(-r[j], q[j]);
+                }
+
+                const double residual_norm = v.l2_norm();
+
+                if (!(residual_norm > drop_tolerance*norm))
+                {
+                    continue;
+                }
+
+                const unsigned int k = q.size();
+
+                for (unsigned int j = 0; j < k; ++j)
+                {
+                    R(j, k) = r[j];
+                }
+
+                R(k, k) = residual_norm;
+
+                v /= residual_norm;
+
+                q.push_back(v);
+
+                columns.push_back(i);
+            }
+
+            const unsigned int n = q.size();
+
+            /* Solve R gamma = Q^T f by back substitution */
+            Vector<double> gamma(n);
+
+            for (unsigned int k = n; k-- > 0;)
+            {
+                double sum = q[k]*f;
+
+                for (unsigned int j = k + 1; j < n; ++j)
+                {
+                    sum -= R(k, j)*gamma(j);
+                }
+
+                gamma(k) = sum/R(k, k);
+            }
+
+            for (unsigned int k = 0; k < n; ++k)
+            {
+                g.add(-gamma(k), this->delta_g[columns[k]]);
+            }
+        }
+
+        unsigned int depth;
+
+        bool has_old_iterate;
+
+        Vector<double> old_f;
+
+        Vector<double> old_g;
+
+        std::deque<Vector<double>> delta_f;
+
+        std::deque<Vector<double>> delta_g;
+    };
+
+}
+
+#endif
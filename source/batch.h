@@ -0,0 +1,409 @@
+#ifndef _batch_h_
+#define _batch_h_
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include <deal.II/base/multithread_info.h>
+#include <deal.II/base/table_handler.h>
+#include <deal.II/base/utilities.h>
+
+#include "phaseflow.h"
+
+/*!
+@brief Run many cases concurrently in one process, e.g. for parameter studies.
+
+@detail
+
+    Usage:
+
+        phaseflow --batch [--threads-per-case N] input ...
+
+    Each input is either a parameter file, which is one case,
+    or a sweep specification ending in ".sweep"; see read_sweep.
+
+    Every case runs in its own directory, named by its index and input, which gets its
+    parameter file, its output files, and its progress messages in stdout.txt.
+    The cases are distributed to MultithreadInfo::n_threads()/N worker threads.
+    N only sets this concurrency: it does not limit the threads of a case,
+    since all cases share deal.II's thread pool. It should be the number of threads
+    which each case is expected to keep busy, e.g. with a multithreaded direct solver.
+
+    A summary table of all cases is printed at the end, and written to batch_summary.txt.
+*/
+namespace Phaseflow
+{
+    namespace Batch
+    {
+        using namespace dealii;
+
+        struct Case
+        {
+            std::string name;
+
+            std::string parameter_file;
+
+            /*! Parameter entries which are appended to the parameter file, so that they override its entries */
+            std::string overrides;
+
+            /*! Short description of the overrides for the summary */
+            std::string description;
+        };
+
+        /*! Get the file name without its directory and extension */
+        std::string get_stem(const std::string &path)
+        {
+            const std::size_t begin = path.find_last_of('/') + 1;
+
+            const std::size_t end = path.find_last_of('.');
+
+            return path.substr(begin, ((end == std::string::npos) || (end < begin)) ? std::string::npos : end - begin);
+        }
+
+        /*! Make parameter entries which set the parameter with the given path, e.g. "physics/rayleigh_number" */
+        std::string make_override(const std::string &path, const std::string &value)
+        {
+            const std::vector<std::string> names = Utilities::split_string_list(path, '/');
+
+            std::string entries;
+
+            for (unsigned int i = 0; i + 1 < names.size(); ++i)
+            {
+                entries += "subsection " + names[i] + "\n";
+            }
+
+            entries += "set " + names.back() + " = " + value + "\n";
+
+            for (unsigned int i = 0; i + 1 < names.size(); ++i)
+            {
+                entries += "end\n";
+            }
+
+            return entries;
+        }
+
+        /*!
+        @brief Read a sweep specification, which runs the cartesian product of lists of parameter values.
+
+        @detail
+
+            For example,
+
+                base = natural_convection_air.prm
+                physics/rayleigh_number = 1.e5 | 1.e6 | 1.e7
+                time/integrator = BackwardEuler | BDF2
+
+            gives six cases. A relative path of the base parameter file is relative to the sweep specification.
+            Lines beginning with # are comments.
+        */
+        std::vector<Case> read_sweep(const std::string &sweep_file)
+        {
+            std::ifstream file(sweep_file);
+
+            AssertThrow(file.good(), ExcMessage("Could not open the sweep specification " + sweep_file));
+
+            std::string base;
+
+            std::vector<std::pair<std::string, std::vector<std::string>>> parameters;
+
+            std::string line;
+
+            while (std::getline(file, line))
+            {
+                line = Utilities::trim(line);
+
+                if (line.empty() || (line[0] == '#'))
+                {
+                    continue;
+                }
+
+                const std::size_t equals = line.find('=');
+
+                AssertThrow(equals != std::string::npos, ExcMessage("Expected \"name = values\" in " + sweep_file + ": " + line));
+
+                const std::string name = Utilities::trim(line.substr(0, equals));
+
+                const std::string values = line.substr(equals + 1);
+
+                if (name == "base")
+                {
+                    base = Utilities::trim(values);
+                }
+                else
+                {
+                    parameters.push_back({name, Utilities::split_string_list(values, '|')});
+                }
+            }
+
+            AssertThrow(!base.empty(), ExcMessage("The sweep specification " + sweep_file + " has no base parameter file."));
+
+            const std::size_t slash = sweep_file.find_last_of('/');
+
+            if ((base[0] != '/') && (slash != std::string::npos))
+            {
+                base = sweep_file.substr(0, slash + 1) + base;
+            }
+
+            std::vector<Case> cases = {{get_stem(sweep_file), base, "", ""}};
+
+            for (auto parameter : parameters)
+            {
+                std::vector<Case> product;
+
+                for (auto c : cases)
+                {
+                    for (auto value : parameter.second)
+                    {
+                        Case new_case = c;
+
+                        new_case.overrides += make_override(parameter.first, value);
+
+                        new_case.description += (c.description.empty() ? "" : ", ") + parameter.first + "=" + value;
+
+                        product.push_back(new_case);
+                    }
+                }
+
+                cases = product;
+            }
+
+            return cases;
+        }
+
+        struct Result
+        {
+            std::string status = "not run";
+
+            unsigned int dim = 0;
+
+            RunSummary summary = {0, 0, 0, 0., false};
+
+            double wall_time = 0.;
+        };
+
+        template<int dim>
+        RunSummary run_case(const std::string &parameter_file, std::ostream &log)
+        {
+            Phaseflow<dim> model(log);
+
+            model.run(parameter_file);
+
+            return model.get_run_summary();
+        }
+
+        /*!
+        @brief Run one case in its directory, with the model's output sent to the case's log file.
+
+        @detail
+
+            If the directory cannot be made, then there is no log file, so the error is printed to std::cout.
+        */
+        Result run_case(const Case &c, std::mutex &print_mutex)
+        {
+            Result result;
+
+            if ((mkdir(c.name.c_str(), 0755) != 0) && (errno != EEXIST))
+            {
+                const std::string error = std::strerror(errno);
+
+                std::lock_guard<std::mutex> lock(print_mutex);
+
+                std::cout << "Case " << c.name << ": could not make its directory: " << error << std::endl;
+
+                result.status = "failed";
+
+                return result;
+            }
+
+            const std::string parameter_file = c.name + "/" + c.name + ".prm";
+
+            std::ofstream log(c.name + "/stdout.txt");
+
+            const auto start = std::chrono::steady_clock::now();
+
+            /* An exception which escaped a worker thread would terminate the whole batch, so every failure is caught here. */
+            try
+            {
+                {
+                    std::ifstream base(c.parameter_file);
+
+                    AssertThrow(base.good(), ExcMessage("Could not open the parameter file " + c.parameter_file));
+
+                    std::ofstream out(parameter_file);
+
+                    out << base.rdbuf() << std::endl
+                        << c.overrides
+                        << make_override("output/directory", c.name);
+                }
+
+                const Parameters::Meta mp = Parameters::read_meta_parameters(parameter_file);
+
+                AssertThrow(!mp.distributed, ExcMessage("The batch mode does not support the distributed model."));
+
+                result.dim = mp.dim;
+
+                switch (mp.dim)
+                {
+                    case 2:
+                        result.summary = run_case<2>(parameter_file, log);
+                        break;
+
+                    case 3:
+                        result.summary = run_case<3>(parameter_file, log);
+                        break;
+
+                    default:
+                        AssertThrow(false, ExcNotImplemented());
+                        break;
+                }
+
+                result.status = result.summary.converged ? "ok" : "not converged";
+            }
+            catch (std::exception &exc)
+            {
+                log << std::endl << "Exception: " << exc.what() << std::endl;
+
+                result.status = "failed";
+            }
+
+            const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start;
+
+            result.wall_time = wall_time.count();
+
+            return result;
+        }
+
+        /*! Run the cases on a pool of threads, and print a summary table. Returns the number of failed cases. */
+        unsigned int run(const std::vector<Case> &cases, const unsigned int threads_per_case)
+        {
+            const unsigned int n_workers = std::max(1u, std::min(
+                (unsigned int)cases.size(),
+                MultithreadInfo::n_threads()/std::max(1u, threads_per_case)));
+
+            std::cout << "Running " << cases.size() << " cases with " << n_workers << " concurrent cases" << std::endl;
+
+            std::vector<Result> results(cases.size());
+
+            std::atomic<unsigned int> next_case(0);
+
+            std::mutex print_mutex;
+
+            auto worker = [&]()
+            {
+                for (unsigned int c = next_case++; c < cases.size(); c = next_case++)
+                {
+                    results[c] = run_case(cases[c], print_mutex);
+
+                    std::lock_guard<std::mutex> lock(print_mutex);
+
+                    std::cout << "Case " << cases[c].name << ": " << results[c].status
+                        << " after " << results[c].wall_time << " s" << std::endl;
+                }
+            };
+
+            std::vector<std::thread> workers;
+
+            for (unsigned int w = 0; w < n_workers; ++w)
+            {
+                workers.push_back(std::thread(worker));
+            }
+
+            for (auto &w : workers)
+            {
+                w.join();
+            }
+
+            TableHandler table;
+
+            unsigned int n_failed = 0;
+
+            for (unsigned int c = 0; c < cases.size(); ++c)
+            {
+                table.add_value("case", cases[c].name);
+                table.add_value("parameters", cases[c].description.empty() ? std::string("-") : cases[c].description);
+                table.add_value("status", results[c].status);
+                table.add_value("dim", results[c].dim);
+                table.add_value("dofs", (unsigned int)results[c].summary.dofs);
+                table.add_value("steps", results[c].summary.time_steps);
+                table.add_value("nonlinear_iterations", results[c].summary.nonlinear_iterations);
+                table.add_value("time", results[c].summary.time);
+                table.add_value("wall_time", results[c].wall_time);
+
+                n_failed += (results[c].status != "ok");
+            }
+
+            table.set_precision("wall_time", 3);
+
+            std::cout << std::endl;
+
+            table.write_text(std::cout, TableHandler::org_mode_table);
+
+            std::ofstream summary_file("batch_summary.txt");
+
+            table.write_text(summary_file);
+
+            return n_failed;
+        }
+
+        /*! Parse the command line arguments after "--batch", and run the cases */
+        int run_command_line(const int argc, char* argv[])
+        {
+            unsigned int threads_per_case = 1;
+
+            std::vector<Case> cases;
+
+            for (int i = 2; i < argc; ++i)
+            {
+                const std::string argument = argv[i];
+
+                if ((argument == "--threads-per-case") && (i + 1 < argc))
+                {
+                    const int value = Utilities::string_to_int(argv[++i]);
+
+                    AssertThrow(value >= 1, ExcMessage("--threads-per-case must be a positive integer."));
+
+                    threads_per_case = value;
+
+                    continue;
+                }
+
+                std::vector<Case> new_cases;
+
+                if ((argument.size() > 6) && (argument.substr(argument.size() - 6) == ".sweep"))
+                {
+                    new_cases = read_sweep(argument);
+                }
+                else
+                {
+                    new_cases.push_back({get_stem(argument), argument, "", ""});
+                }
+
+                for (auto c : new_cases)
+                {
+                    c.name = Utilities::int_to_string(cases.size(), 3) + "-" + c.name;
+
+                    cases.push_back(c);
+                }
+            }
+
+            AssertThrow(!cases.empty(), ExcMessage("Usage: phaseflow --batch [--threads-per-case N] input ..."));
+
+            return (run(cases, threads_per_case) > 0) ? 1 : 0;
+        }
+
+    }
+
+}
+
+#endif
@@ -0,0 +1,429 @@
+#ifndef _block_multigrid_preconditioner_h_
+#define _block_multigrid_preconditioner_h_
+
+#include <memory>
+#include <set>
+
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_tools.h>
+#include <deal.II/fe/fe_system.h>
+#include <deal.II/fe/fe_values.h>
+#include <deal.II/lac/constraint_matrix.h>
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/sparse_matrix.h>
+#include <deal.II/lac/sparsity_pattern.h>
+#include <deal.II/lac/vector.h>
+#include <deal.II/multigrid/mg_coarse.h>
+#include <deal.II/multigrid/mg_constrained_dofs.h>
+#include <deal.II/multigrid/mg_matrix.h>
+#include <deal.II/multigrid/mg_smoother.h>
+#include <deal.II/multigrid/mg_tools.h>
+#include <deal.II/multigrid/mg_transfer.h>
+#include <deal.II/multigrid/multigrid.h>
+
+namespace LinearSolvers
+{
+    using namespace dealii;
+
+    /*!
+    @brief Geometric multigrid V-cycle for one field of the coupled system.
+
+    @detail
+
+        The field has its own DoFHandler on the shared triangulation, so that the level
+        DoFs follow the refinement hierarchy of the grid. Each level matrix discretizes
+
+            $m (u, v) + k (\nabla u, \nabla v)$,
+
+        i.e. the time derivative and the diffusion, which dominate the field's diagonal block
+        of the Jacobian. Strong boundary DoFs are zero on every level.
+
+        Smoothing is symmetric SOR, and the coarse level is solved with a Householder factorization.
+    */
+    template<int dim>
+    class FieldMultigrid
+    {
+    public:
+
+        FieldMultigrid(const FiniteElement<dim> &_fe)
+            :
+            fe(_fe.clone())
+        {}
+
+        /*! Distribute the level DoFs, and map the active DoFs to those of the coupled system */
+        void setup(
+            const DoFHandler<dim> &system_dof_handler,
+            const unsigned int first_system_component,
+            const std::set<types::boundary_id> &dirichlet_boundaries,
+            const unsigned int smoothing_steps)
+        {
+            const Triangulation<dim> &triangulation = system_dof_handler.get_triangulation();
+
+            this->dof_handler.initialize(triangulation, *this->fe);
+
+            this->dof_handler.distribute_mg_dofs();
+
+            this->map_to_system(system_dof_handler, first_system_component);
+
+            this->mg_constrained_dofs.clear();
+
+            this->mg_constrained_dofs.initialize(this->dof_handler);
+
+            this->mg_constrained_dofs.make_zero_boundary_constraints(this->dof_handler, dirichlet_boundaries);
+
+            const unsigned int n_levels = triangulation.n_levels();
+
+            this->level_constraints.resize(0, n_levels - 1);
+
+            this->level_sparsity_patterns.resize(0, n_levels - 1);
+
+            this->level_matrices.resize(0, n_levels - 1);
+
+            for (unsigned int level = 0; level < n_levels; ++level)
+            {
+                this->level_constraints[level].clear();
+
+                this->level_constraints[level].add_lines(this->mg_constrained_dofs.get_boundary_indices(level));
+
+                this->level_constraints[level].close();
+
+                DynamicSparsityPattern dsp(this->dof_handler.n_dofs(level), this->dof_handler.n_dofs(level));
+
+                MGTools::make_sparsity_pattern(this->dof_handler, dsp, level);
+
+                this->level_sparsity_patterns[level].copy_from(dsp);
+
+                this->level_matrices[level].reinit(this->level_sparsity_patterns[level]);
+            }
+
+            this->transfer.initialize_constraints(this->mg_constrained_dofs);
+
+            this->transfer.build_matrices(this->dof_handler);
+
+            this->smoother.set_steps(smoothing_steps);
+
+            this->smoother.set_symmetric(true);
+
+            this->level_matrix_wrapper.initialize(this->level_matrices);
+
+            this->multigrid.reset(new Multigrid<Vector<double>>(
+                this->level_matrix_wrapper,
+                this->coarse_grid_solver,
+                this->transfer,
+                this->smoother,
+                this->smoother));
+
+            this->preconditioner.reset(new PreconditionMG<dim, Vector<double>, MGTransferPrebuilt<Vector<double>>>(
+                this->dof_handler,
+                *this->multigrid,
+                this->transfer));
+
+            this->field_src.reinit(this->dof_handler.n_dofs());
+
+            this->field_dst.reinit(this->dof_handler.n_dofs());
+
+            this->mass_coefficient = -1.;
+
+            this->diffusion_coefficient = -1.;
+        }
+
+        /*! Assemble the level matrices, unless the coefficients are unchanged since the last call */
+        void initialize(const double _mass_coefficient, const double _diffusion_coefficient)
+        {
+            if ((_mass_coefficient == this->mass_coefficient) & (_diffusion_coefficient == this->diffusion_coefficient))
+            {
+                return;
+            }
+
+            this->mass_coefficient = _mass_coefficient;
+
+            this->diffusion_coefficient = _diffusion_coefficient;
+
+            const QGauss<dim> quadrature(this->fe->degree + 1);
+
+            FEValues<dim> fe_values(*this->fe, quadrature, update_values | update_gradients | update_JxW_values);
+
+            const unsigned int dofs_per_cell = this->fe->dofs_per_cell;
+
+            FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
+
+            std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+
+            for (unsigned int level = this->level_matrices.min_level(); level <= this->level_matrices.max_level(); ++level)
+            {
+                this->level_matrices[level] = 0.;
+            }
+
+            for (auto cell : this->dof_handler.cell_iterators())
+            {
+                fe_values.reinit(cell);
+
+                cell_matrix = 0.;
+
+                for (unsigned int quad = 0; quad < quadrature.size(); ++quad)
+                {
+                    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+                    {
+                        const unsigned int component_i = this->fe->system_to_component_index(i).first;
+
+                        for (unsigned int j = 0; j < dofs_per_cell; ++j)
+                        {
+                            if (this->fe->system_to_component_index(j).first != component_i)
+                            {
+                                continue;
+                            }
+
+                            cell_matrix(i, j) += (
+                                this->mass_coefficient*fe_values.shape_value(i, quad)*fe_values.shape_value(j, quad)
+                                + this->diffusion_coefficient*fe_values.shape_grad(i, quad)*fe_values.shape_grad(j, quad)
+                                )*fe_values.JxW(quad);
+                        }
+                    }
+                }
+
+                cell->get_mg_dof_indices(local_dof_indices);
+
+                this->level_constraints[cell->level()].distribute_local_to_global(
+                    cell_matrix,
+                    local_dof_indices,
+                    this->level_matrices[cell->level()]);
+            }
+
+            this->smoother.initialize(this->level_matrices);
+
+            this->coarse_matrix.copy_from(this->level_matrices[this->level_matrices.min_level()]);
+
+            this->coarse_grid_solver.initialize(this->coarse_matrix);
+        }
+
+        /*! Apply one V-cycle to the entries of src which belong to this field, and write them to dst */
+        void vmult(Vector<double> &dst, const Vector<double> &src) const
+        {
+            for (unsigned int i = 0; i < this->system_dof_indices.size(); ++i)
+            {
+                this->field_src(i) = src(this->system_dof_indices[i]);
+            }
+
+            this->preconditioner->vmult(this->field_dst, this->field_src);
+
+            for (unsigned int i = 0; i < this->system_dof_indices.size(); ++i)
+            {
+                dst(this->system_dof_indices[i]) = this->field_dst(i);
+            }
+        }
+
+    private:
+
+        void map_to_system(const DoFHandler<dim> &system_dof_handler, const unsigned int first_system_component)
+        {
+            const FiniteElement<dim> &system_fe = system_dof_handler.get_fe();
+
+            this->system_dof_indices.resize(this->dof_handler.n_dofs());
+
+            std::vector<types::global_dof_index> field_indices(this->fe->dofs_per_cell);
+
+            std::vector<types::global_dof_index> system_indices(system_fe.dofs_per_cell);
+
+            auto field_cell = this->dof_handler.begin_active();
+
+            for (auto system_cell : system_dof_handler.active_cell_iterators())
+            {
+                field_cell->get_dof_indices(field_indices);
+
+                system_cell->get_dof_indices(system_indices);
+
+                for (unsigned int i = 0; i < this->fe->dofs_per_cell; ++i)
+                {
+                    const std::pair<unsigned int, unsigned int> component_and_index =
+                        this->fe->system_to_component_index(i);
+
+                    this->system_dof_indices[field_indices[i]] = system_indices[
+                        system_fe.component_to_system_index(
+                            first_system_component + component_and_index.first,
+                            component_and_index.second)];
+                }
+
+                ++field_cell;
+            }
+        }
+
+        std::unique_ptr<FiniteElement<dim>> fe;
+
+        DoFHandler<dim> dof_handler;
+
+        std::vector<types::global_dof_index> system_dof_indices;
+
+        MGConstrainedDoFs mg_constrained_dofs;
+
+        MGLevelObject<ConstraintMatrix> level_constraints;
+
+        MGLevelObject<SparsityPattern> level_sparsity_patterns;
+
+        MGLevelObject<SparseMatrix<double>> level_matrices;
+
+        MGTransferPrebuilt<Vector<double>> transfer;
+
+        FullMatrix<double> coarse_matrix;
+
+        MGCoarseGridHouseholder<double, Vector<double>> coarse_grid_solver;
+
+        mg::SmootherRelaxation<PreconditionSOR<SparseMatrix<double>>, Vector<double>> smoother;
+
+        mg::Matrix<Vector<double>> level_matrix_wrapper;
+
+        std::unique_ptr<Multigrid<Vector<double>>> multigrid;
+
+        std::unique_ptr<PreconditionMG<dim, Vector<double>, MGTransferPrebuilt<Vector<double>>>> preconditioner;
+
+        mutable Vector<double> field_src;
+
+        mutable Vector<double> field_dst;
+
+        double mass_coefficient;
+
+        double diffusion_coefficient;
+    };
+
+    /*!
+    @brief Block diagonal preconditioner for the Newton linearized Navier-Stokes-Boussinesq system.
+
+    @detail
+
+        The velocity and the temperature blocks are approximately inverted with one geometric multigrid
+        V-cycle each. The pressure Schur complement is approximated by the lumped pressure mass matrix
+        scaled by the inverse viscosity, as is usual for Stokes-like problems. Rows which were
+        replaced by strong boundary conditions are scaled by the inverse of their diagonal entry.
+
+        This relies on component-wise DoF numbering of the coupled system, and on a grid without
+        hanging nodes.
+
+        The level operators neglect advection and the coupling blocks, and have constant coefficients.
+        So the GMRES iterations only stay bounded under refinement when the time derivative and diffusion
+        dominate, i.e. for small time steps or small Rayleigh numbers. For convection dominated flows,
+        e.g. natural convection at Ra = 1e6 with large time steps, the iterations can grow with the refinement.
+    */
+    template<int dim>
+    class BlockMultigridPreconditioner
+    {
+    public:
+
+        BlockMultigridPreconditioner(
+            const FiniteElement<dim> &velocity_fe,
+            const FiniteElement<dim> &temperature_fe)
+            :
+            velocity_multigrid(velocity_fe),
+            temperature_multigrid(temperature_fe)
+        {}
+
+        void setup(
+            const DoFHandler<dim> &system_dof_handler,
+            const std::set<types::boundary_id> &velocity_boundaries,
+            const std::set<types::boundary_id> &temperature_boundaries,
+            const std::vector<types::global_dof_index> &_strong_boundary_dofs,
+            const unsigned int smoothing_steps)
+        {
+            this->velocity_multigrid.setup(system_dof_handler, 0, velocity_boundaries, smoothing_steps);
+
+            this->temperature_multigrid.setup(system_dof_handler, dim + 1, temperature_boundaries, smoothing_steps);
+
+            this->strong_boundary_dofs = _strong_boundary_dofs;
+
+            /* Lump the pressure mass matrix */
+            const FiniteElement<dim> &system_fe = system_dof_handler.get_fe();
+
+            const QGauss<dim> quadrature(system_fe.degree + 1);
+
+            FEValues<dim> fe_values(system_fe, quadrature, update_values | update_JxW_values);
+
+            std::vector<types::global_dof_index> local_dof_indices(system_fe.dofs_per_cell);
+
+            this->pressure_mass_diagonal.reinit(system_dof_handler.n_dofs());
+
+            this->pressure_dofs.clear();
+
+            for (auto cell : system_dof_handler.active_cell_iterators())
+            {
+                fe_values.reinit(cell);
+
+                cell->get_dof_indices(local_dof_indices);
+
+                for (unsigned int i = 0; i < system_fe.dofs_per_cell; ++i)
+                {
+                    if (system_fe.system_to_component_index(i).first != dim)
+                    {
+                        continue;
+                    }
+
+                    for (unsigned int quad = 0; quad < quadrature.size(); ++quad)
+                    {
+                        this->pressure_mass_diagonal(local_dof_indices[i]) +=
+                            fe_values.shape_value(i, quad)*fe_values.JxW(quad);
+                    }
+                }
+            }
+
+            for (unsigned int i = 0; i < this->pressure_mass_diagonal.size(); ++i)
+            {
+                if (this->pressure_mass_diagonal(i) != 0.)
+                {
+                    this->pressure_dofs.push_back(i);
+                }
+            }
+        }
+
+        /*! Update the level operators for the given coefficients, and point to the current system matrix */
+        void initialize(
+            const SparseMatrix<double> &_system_matrix,
+            const double mass_coefficient,
+            const double viscosity,
+            const double conductivity)
+        {
+            this->system_matrix = &_system_matrix;
+
+            this->viscosity = viscosity;
+
+            this->velocity_multigrid.initialize(mass_coefficient, viscosity);
+
+            this->temperature_multigrid.initialize(mass_coefficient, conductivity);
+        }
+
+        void vmult(Vector<double> &dst, const Vector<double> &src) const
+        {
+            this->velocity_multigrid.vmult(dst, src);
+
+            this->temperature_multigrid.vmult(dst, src);
+
+            for (auto i : this->pressure_dofs)
+            {
+                dst(i) = -this->viscosity*src(i)/this->pressure_mass_diagonal(i);
+            }
+
+            for (auto i : this->strong_boundary_dofs)
+            {
+                dst(i) = src(i)/this->system_matrix->diag_element(i);
+            }
+        }
+
+    private:
+
+        FieldMultigrid<dim> velocity_multigrid;
+
+        FieldMultigrid<dim> temperature_multigrid;
+
+        std::vector<types::global_dof_index> strong_boundary_dofs;
+
+        std::vector<types::global_dof_index> pressure_dofs;
+
+        Vector<double> pressure_mass_diagonal;
+
+        const SparseMatrix<double> *system_matrix = nullptr;
+
+        double viscosity;
+    };
+
+}
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef _cell_values_cache_h_
+#define _cell_values_cache_h_
+
+#include <vector>
+
+#include <deal.II/base/point.h>
+#include <deal.II/base/quadrature.h>
+#include <deal.II/base/tensor.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/fe/fe.h>
+#include <deal.II/fe/fe_values.h>
+
+namespace Phaseflow
+{
+    namespace LocalAssembly
+    {
+        using namespace dealii;
+
+        /*!
+        @brief Mapped shape function gradients, JxW values and quadrature points of every active cell.
+
+        @detail
+
+            On a fixed grid, these are the same for every assembly, so they can be computed once
+            instead of reinitializing FEValues on each cell for each assembly.
+
+            The shape values of the Lagrange elements do not depend on the cell, so they are only stored once.
+
+            The cache is only built if it fits within the given memory,
+            and otherwise it stays empty, so that the assembly falls back to FEValues.
+        */
+        template<int dim>
+        class CellValuesCache
+        {
+        public:
+
+            /*! The subset of the FEValues interface which is used by the cell kernels, for one cell of the cache */
+            class CellValues
+            {
+            public:
+
+                CellValues(const CellValuesCache<dim> &_cache, const unsigned int _cell_index)
+                    :
+                    dofs_per_cell(_cache.dofs_per_cell),
+                    n_quadrature_points(_cache.n_quadrature_points),
+                    cache(_cache),
+                    cell_index(_cell_index)
+                {}
+
+                const FiniteElement<dim> &get_fe() const
+                {
+                    return *this->cache.fe;
+                }
+
+                double shape_value(const unsigned int i, const unsigned int q) const
+                {
+                    return this->cache.shape_values[i*this->n_quadrature_points + q];
+                }
+
+                const Tensor<1, dim> &shape_grad(const unsigned int i, const unsigned int q) const
+                {
+                    return this->cache.shape_gradients[
+                        (this->cell_index*this->dofs_per_cell + i)*this->n_quadrature_points + q];
+                }
+
+                double JxW(const unsigned int q) const
+                {
+                    return this->cache.JxW_values[this->cell_index*this->n_quadrature_points + q];
+                }
+
+                const std::vector<Point<dim>> &get_quadrature_points() const
+                {
+                    return this->cache.quadrature_points[this->cell_index];
+                }
+
+                const unsigned int dofs_per_cell;
+
+                const unsigned int n_quadrature_points;
+
+            private:
+
+                const CellValuesCache<dim> &cache;
+
+                const unsigned int cell_index;
+            };
+
+            /*! Estimate the memory in bytes which the cache would take */
+            static std::size_t estimate_memory_consumption(
+                const unsigned int n_cells,
+                const unsigned int dofs_per_cell,
+                const unsigned int n_quadrature_points)
+            {
+                return std::size_t(n_cells)*n_quadrature_points*(
+                    dofs_per_cell*sizeof(Tensor<1, dim>) + sizeof(double) + sizeof(Point<dim>));
+            }
+
+            /*!
+            @brief Compute the values on every active cell of the DoFHandler.
+
+            @detail
+
+                Returns false, and leaves the cache empty, if it would take more than max_memory bytes.
+            */
+            bool reinit(
+                const DoFHandler<dim> &dof_handler,
+                const Quadrature<dim> &quadrature,
+                const std::size_t max_memory)
+            {
+                this->clear();
+
+                const FiniteElement<dim> &_fe = dof_handler.get_fe();
+
+                const unsigned int n_cells = dof_handler.get_triangulation().n_active_cells();
+
+                if (estimate_memory_consumption(n_cells, _fe.dofs_per_cell, quadrature.size()) > max_memory)
+                {
+                    return false;
+                }
+
+                this->fe = &_fe;
+
+                this->dofs_per_cell = _fe.dofs_per_cell;
+
+                this->n_quadrature_points = quadrature.size();
+
+                this->shape_values.resize(this->dofs_per_cell*this->n_quadrature_points);
+
+                this->shape_gradients.resize(std::size_t(n_cells)*this->dofs_per_cell*this->n_quadrature_points);
+
+                this->JxW_values.resize(std::size_t(n_cells)*this->n_quadrature_points);
+
+                this->quadrature_points.resize(n_cells);
+
+                FEValues<dim> fe_values(
+                    _fe,
+                    quadrature,
+                    update_values | update_gradients | update_quadrature_points | update_JxW_values);
+
+                for (auto cell : dof_handler.active_cell_iterators())
+                {
+                    fe_values.reinit(cell);
+
+                    const std::size_t c = cell->active_cell_index();
+
+                    for (unsigned int i = 0; i < this->dofs_per_cell; ++i)
+                    {
+                        for (unsigned int q = 0; q < this->n_quadrature_points; ++q)
+                        {
+                            this->shape_values[i*this->n_quadrature_points + q] = fe_values.shape_value(i, q);
+
+                            this->shape_gradients[(c*this->dofs_per_cell + i)*this->n_quadrature_points + q] =
+                                fe_values.shape_grad(i, q);
+                        }
+                    }
+
+                    for (unsigned int q = 0; q < this->n_quadrature_points; ++q)
+                    {
+                        this->JxW_values[c*this->n_quadrature_points + q] = fe_values.JxW(q);
+                    }
+
+                    this->quadrature_points[c] = fe_values.get_quadrature_points();
+                }
+
+                return true;
+            }
+
+            void clear()
+            {
+                this->fe = nullptr;
+
+                this->shape_values.clear();
+
+                this->shape_gradients.clear();
+
+                this->JxW_values.clear();
+
+                this->quadrature_points.clear();
+            }
+
+            bool empty() const
+            {
+                return this->fe == nullptr;
+            }
+
+            CellValues cell_values(const unsigned int active_cell_index) const
+            {
+                return CellValues(*this, active_cell_index);
+            }
+
+            std::size_t memory_consumption() const
+            {
+                return estimate_memory_consumption(
+                    this->quadrature_points.size(), this->dofs_per_cell, this->n_quadrature_points);
+            }
+
+        private:
+
+            const FiniteElement<dim> *fe = nullptr;
+
+            unsigned int dofs_per_cell = 0;
+
+            unsigned int n_quadrature_points = 0;
+
+            std::vector<double> shape_values;
+
+            std::vector<Tensor<1, dim>> shape_gradients;
+
+            std::vector<double> JxW_values;
+
+            std::vector<std::vector<Point<dim>>> quadrature_points;
+        };
+
+    }
+
+}
+
+#endif
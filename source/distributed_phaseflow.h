@@ -0,0 +1,779 @@
+#ifndef _distributed_phaseflow_h_
+#define _distributed_phaseflow_h_
+
+#include <deal.II/base/config.h>
+
+#if defined(DEAL_II_WITH_P4EST) && defined(DEAL_II_WITH_TRILINOS)
+
+#include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/index_set.h>
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/base/parsed_function.h>
+#include <deal.II/base/utilities.h>
+#include <deal.II/distributed/tria.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_renumbering.h>
+#include <deal.II/dofs/dof_tools.h>
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/fe_system.h>
+#include <deal.II/fe/fe_values.h>
+#include <deal.II/grid/manifold_lib.h>
+#include <deal.II/lac/constraint_matrix.h>
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/sparsity_tools.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
+#include <deal.II/lac/trilinos_vector.h>
+#include <deal.II/lac/trilinos_solver.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/numerics/data_out.h>
+#include <deal.II/numerics/vector_tools.h>
+
+#include <iostream>
+
+#include "my_grid_generator.h"
+
+#include "pf_parameters.h"
+
+#include "pf_global_parameters.h"
+
+#include "pf_local_assembly.h"
+
+namespace Phaseflow
+{
+  using namespace dealii;
+
+  /*!
+  @brief Distributed memory version of the Phaseflow model.
+
+  @detail
+
+    The grid is a parallel::distributed::Triangulation, and the linear algebra uses Trilinos.
+    Every MPI process only stores its locally owned cells, and the locally owned and locally relevant
+    entries of the matrix and vectors. The cell-wise assembly is shared with the serial model.
+
+    Strong boundary conditions for the Newton correction are applied as inhomogeneous constraints
+    during assembly, which is the usual approach for distributed matrices.
+
+    This supports the monolithic Newton method with backward Euler or BDF2 time stepping,
+    solving each linear system with a Trilinos direct solver or with ILU preconditioned GMRES.
+    The other solver options of the serial model are not yet supported.
+
+    Run it with, e.g.,
+
+        mpirun -np 4 ./phaseflow input.prm
+  */
+  template<int dim>
+  class DistributedPhaseflow
+  {
+  public:
+
+    DistributedPhaseflow(MPI_Comm _mpi_communicator = MPI_COMM_WORLD);
+
+    Parameters::StructuredParameters params;
+
+    void run(const std::string parameter_file = "");
+
+  private:
+
+    void assert_supported_parameters() const;
+
+    void setup_system();
+
+    void make_newton_constraints();
+
+    void assemble_system();
+
+    void solve_linear_system();
+
+    double step_newton();
+
+    bool solve_nonlinear_problem();
+
+    void set_time_step_size(double new_size);
+
+    void step_time();
+
+    double compute_unsteadiness() const;
+
+    void write_solution();
+
+    MPI_Comm mpi_communicator;
+
+    ConditionalOStream pcout;
+
+    parallel::distributed::Triangulation<dim> triangulation;
+
+    FESystem<dim,dim> fe;
+
+    const FEValuesExtractors::Vector velocity_extractor;
+
+    const FEValuesExtractors::Scalar pressure_extractor;
+
+    const FEValuesExtractors::Scalar temperature_extractor;
+
+    DoFHandler<dim> dof_handler;
+
+    IndexSet locally_owned_dofs;
+
+    IndexSet locally_relevant_dofs;
+
+    /*! Hanging node constraints */
+    ConstraintMatrix constraints;
+
+    /*! Hanging node constraints, and the strong boundary conditions for the Newton correction */
+    ConstraintMatrix newton_constraints;
+
+    TrilinosWrappers::SparseMatrix system_matrix;
+
+    /*! These are ghosted, i.e. they contain the locally relevant entries */
+    TrilinosWrappers::MPI::Vector solution;
+
+    TrilinosWrappers::MPI::Vector newton_solution;
+
+    TrilinosWrappers::MPI::Vector old_solution;
+
+    TrilinosWrappers::MPI::Vector old_old_solution;
+
+    /*! These only contain the locally owned entries */
+    TrilinosWrappers::MPI::Vector newton_residual;
+
+    TrilinosWrappers::MPI::Vector system_rhs;
+
+    double time;
+
+    double new_time;
+
+    double time_step_size;
+
+    double old_time_step_size = 0.;
+
+    unsigned int time_step_counter;
+
+    unsigned int boundary_count;
+
+    std::vector<unsigned int> manifold_ids;
+
+    std::vector<std::string> manifold_descriptors;
+
+    Functions::ParsedFunction<dim> source_function;
+
+    Functions::ParsedFunction<dim> initial_values_function;
+
+    Functions::ParsedFunction<dim> boundary_function;
+
+    Functions::ParsedFunction<dim> exact_solution_function;
+
+  };
+
+  template<int dim>
+  DistributedPhaseflow<dim>::DistributedPhaseflow(MPI_Comm _mpi_communicator)
+    :
+    mpi_communicator(_mpi_communicator),
+    pcout(std::cout, Utilities::MPI::this_mpi_process(_mpi_communicator) == 0),
+    triangulation(
+        _mpi_communicator,
+        typename Triangulation<dim>::MeshSmoothing(
+            Triangulation<dim>::smoothing_on_refinement | Triangulation<dim>::smoothing_on_coarsening)),
+    fe(FE_Q<dim>(SCALAR_DEGREE + 1), dim, // velocity
+       FE_Q<dim>(SCALAR_DEGREE), 1, // pressure
+       FE_Q<dim>(SCALAR_DEGREE), 1), // temperature
+    velocity_extractor(0),
+    pressure_extractor(dim),
+    temperature_extractor(dim + 1),
+    dof_handler(this->triangulation),
+    source_function(dim + 2),
+    initial_values_function(dim + 2),
+    boundary_function(dim + 2),
+    exact_solution_function(dim + 2)
+  {}
+
+  template<int dim>
+  void DistributedPhaseflow<dim>::assert_supported_parameters() const
+  {
+    AssertThrow(this->params.nonlinear_solver.method == "Newton",
+        ExcMessage("The distributed model only supports the Newton method."));
+
+    AssertThrow(this->params.nonlinear_solver.coupling == "monolithic",
+        ExcMessage("The distributed model only supports monolithic coupling."));
+
+    AssertThrow(!this->params.linear_solver.inexact_newton.enabled,
+        ExcMessage("The distributed model does not support inexact Newton."));
+
+    AssertThrow(!this->params.pseudo_transient.enabled,
+        ExcMessage("The distributed model does not support pseudo-transient continuation."));
+
+    AssertThrow(this->params.continuation.parameter == "none",
+        ExcMessage("The distributed model does not support parameter continuation."));
+
+    AssertThrow(this->params.time.error_tolerance == 0.,
+        ExcMessage("The distributed model does not support time step error control."));
+
+    AssertThrow(!this->params.verification.enabled,
+        ExcMessage("The distributed model does not support verification."));
+
+    AssertThrow(this->params.linear_solver.method != "mixed_precision",
+        ExcMessage("The distributed model does not support the mixed precision linear solver."));
+
+    AssertThrow(this->params.linear_solver.preconditioner == "ILU",
+        ExcMessage("The distributed model only supports the ILU preconditioner."));
+
+    AssertThrow(this->params.renumbering.methods.empty() && !this->params.renumbering.report_statistics,
+        ExcMessage("The distributed model does not support DoF renumbering."));
+
+    AssertThrow(!this->params.assembly.precompute_linear_terms,
+        ExcMessage("The distributed model does not support precomputing the linear terms."));
+
+    AssertThrow(!this->params.assembly.incremental_jacobian,
+        ExcMessage("The distributed model does not support the incremental Jacobian."));
+
+    AssertThrow(!this->params.assembly.cache_cell_values,
+        ExcMessage("The distributed model does not support the cell values cache."));
+
+    AssertThrow(!this->params.grid_cache.enabled,
+        ExcMessage("The distributed model does not support the grid cache."));
+
+    AssertThrow(!this->params.profiling.enabled && !this->params.profiling.memory_report,
+        ExcMessage("The distributed model does not support profiling."));
+
+    AssertThrow(!this->params.telemetry.enabled,
+        ExcMessage("The distributed model does not support telemetry."));
+
+    AssertThrow(!this->params.output.write_newton_iterates,
+        ExcMessage("The distributed model does not write the Newton iterates."));
+  }
+
+  /*! Setup the distributed linear system objects. */
+  template<int dim>
+  void DistributedPhaseflow<dim>::setup_system()
+  {
+    this->dof_handler.distribute_dofs(this->fe);
+
+    DoFRenumbering::component_wise(this->dof_handler);
+
+    this->locally_owned_dofs = this->dof_handler.locally_owned_dofs();
+
+    DoFTools::extract_locally_relevant_dofs(this->dof_handler, this->locally_relevant_dofs);
+
+    this->pcout << std::endl
+            << "==========================================="
+            << std::endl
+            << "Number of MPI processes: " << Utilities::MPI::n_mpi_processes(this->mpi_communicator)
+            << std::endl
+            << "Number of active cells: " << this->triangulation.n_global_active_cells()
+            << std::endl
+            << "Number of degrees of freedom: " << this->dof_handler.n_dofs()
+            << std::endl
+            << std::endl;
+
+    this->constraints.clear();
+
+    this->constraints.reinit(this->locally_relevant_dofs);
+
+    DoFTools::make_hanging_node_constraints(
+        this->dof_handler,
+        this->constraints);
+
+    this->constraints.close();
+
+    DynamicSparsityPattern dsp(this->locally_relevant_dofs);
+
+    DoFTools::make_sparsity_pattern(
+        this->dof_handler,
+        dsp,
+        this->constraints,
+        /*keep_constrained_dofs = */ true);
+
+    SparsityTools::distribute_sparsity_pattern(
+        dsp,
+        this->dof_handler.n_locally_owned_dofs_per_processor(),
+        this->mpi_communicator,
+        this->locally_relevant_dofs);
+
+    this->system_matrix.reinit(
+        this->locally_owned_dofs,
+        this->locally_owned_dofs,
+        dsp,
+        this->mpi_communicator);
+
+    for (auto vector : {&this->solution, &this->newton_solution, &this->old_solution, &this->old_old_solution})
+    {
+        vector->reinit(this->locally_owned_dofs, this->locally_relevant_dofs, this->mpi_communicator);
+    }
+
+    this->newton_residual.reinit(this->locally_owned_dofs, this->mpi_communicator);
+
+    this->system_rhs.reinit(this->locally_owned_dofs, this->mpi_communicator);
+  }
+
+  /*!
+  @brief Constrain the Newton correction with the hanging nodes and the strong boundary conditions.
+
+  @detail
+
+    As in the serial model, the boundary values of the correction are the difference between
+    the boundary function at the new time and the solution at the current time.
+  */
+  template<int dim>
+  void DistributedPhaseflow<dim>::make_newton_constraints()
+  {
+    this->newton_constraints.clear();
+
+    this->newton_constraints.reinit(this->locally_relevant_dofs);
+
+    DoFTools::make_hanging_node_constraints(
+        this->dof_handler,
+        this->newton_constraints);
+
+    this->boundary_function.set_time(this->new_time);
+
+    std::map<types::global_dof_index, double> new_boundary_values;
+
+    for (unsigned int ib = 0; ib < this->params.boundary_conditions.strong_boundaries.size(); ++ib)
+    {
+        const unsigned int b = this->params.boundary_conditions.strong_boundaries[ib];
+
+        for (auto field_name : this->params.boundary_conditions.strong_masks[ib])
+        {
+            ComponentMask mask;
+
+            if (field_name == "velocity")
+            {
+                mask = this->fe.component_mask(this->velocity_extractor);
+            }
+            else if (field_name == "pressure")
+            {
+                mask = this->fe.component_mask(this->pressure_extractor);
+            }
+            else if (field_name == "temperature")
+            {
+                mask = this->fe.component_mask(this->temperature_extractor);
+            }
+            else
+            {
+                Assert(false, ExcNotImplemented());
+            }
+
+            VectorTools::interpolate_boundary_values(
+                this->dof_handler, b, this->boundary_function, new_boundary_values, mask);
+        }
+    }
+
+    for (auto m : new_boundary_values)
+    {
+        if (!this->locally_relevant_dofs.is_element(m.first) | this->newton_constraints.is_constrained(m.first))
+        {
+            continue;
+        }
+
+        this->newton_constraints.add_line(m.first);
+
+        this->newton_constraints.set_inhomogeneity(m.first, m.second - this->old_solution(m.first));
+    }
+
+    this->newton_constraints.close();
+  }
+
+  /*! Assemble the Newton linearized system on the locally owned cells; see Phaseflow<dim>::assemble_system. */
+  template<int dim>
+  void DistributedPhaseflow<dim>::assemble_system()
+  {
+    this->system_matrix = 0.;
+
+    this->system_rhs = 0.;
+
+    double alpha_0, alpha_1, alpha_2;
+
+    LocalAssembly::get_time_derivative_coefficients(
+        (this->params.time.integrator == "BDF2") & (this->old_time_step_size > 0.),
+        this->time_step_size,
+        this->old_time_step_size,
+        alpha_0, alpha_1, alpha_2);
+
+    const LocalAssembly::Coefficients<dim> coefficients = LocalAssembly::make_coefficients<dim>(
+        this->params,
+        this->time_step_size,
+        alpha_0, alpha_1, alpha_2,
+        false);
+
+    QGauss<dim> quadrature_formula(SCALAR_DEGREE + 2);
+
+    FEValues<dim> fe_values(
+        this->fe,
+        quadrature_formula,
+        update_values | update_gradients | update_quadrature_points | update_JxW_values);
+
+    const unsigned int dofs_per_cell = this->fe.dofs_per_cell;
+
+    FullMatrix<double> local_matrix(dofs_per_cell, dofs_per_cell);
+
+    Vector<double> local_rhs(dofs_per_cell);
+
+    std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+
+    LocalAssembly::ScratchData<dim> scratch(quadrature_formula.size(), dofs_per_cell);
+
+    this->source_function.set_time(this->new_time);
+
+    for (auto cell : this->dof_handler.active_cell_iterators())
+    {
+        if (!cell->is_locally_owned())
+        {
+            continue;
+        }
+
+        fe_values.reinit(cell);
+
+        cell->get_dof_indices(local_dof_indices);
+
+        LocalAssembly::assemble_cell(
+            fe_values,
+            this->velocity_extractor,
+            this->pressure_extractor,
+            this->temperature_extractor,
+            this->old_solution,
+            this->old_old_solution,
+            this->newton_solution,
+            local_dof_indices,
+            this->source_function,
+            coefficients,
+            scratch,
+            local_matrix,
+            local_rhs);
+
+        this->newton_constraints.distribute_local_to_global(
+            local_matrix, local_rhs, local_dof_indices,
+            this->system_matrix, this->system_rhs);
+    }
+
+    this->system_matrix.compress(VectorOperation::add);
+
+    this->system_rhs.compress(VectorOperation::add);
+  }
+
+  template<int dim>
+  void DistributedPhaseflow<dim>::solve_linear_system()
+  {
+    if (this->params.linear_solver.method == "direct")
+    {
+        SolverControl solver_control;
+
+        TrilinosWrappers::SolverDirect solver(solver_control);
+
+        solver.solve(this->system_matrix, this->newton_residual, this->system_rhs);
+
+        this->pcout << "Solved linear system" << std::endl;
+    }
+    else
+    {
+        SolverControl solver_control(
+            this->params.linear_solver.max_iterations,
+            this->params.linear_solver.tolerance*this->system_rhs.l2_norm());
+
+        TrilinosWrappers::SolverGMRES solver(
+            solver_control,
+            TrilinosWrappers::SolverGMRES::AdditionalData(false, this->params.linear_solver.gmres_restart));
+
+        TrilinosWrappers::PreconditionILU preconditioner;
+
+        preconditioner.initialize(this->system_matrix);
+
+        solver.solve(this->system_matrix, this->newton_residual, this->system_rhs, preconditioner);
+
+        this->pcout << "Solved linear system with " << solver_control.last_step() << " GMRES iterations" << std::endl;
+    }
+
+    this->newton_constraints.distribute(this->newton_residual);
+  }
+
+  /*! Setup and solve a Newton iteration, and return the L2 norm of the relative correction */
+  template<int dim>
+  double DistributedPhaseflow<dim>::step_newton()
+  {
+    this->make_newton_constraints();
+
+    this->assemble_system();
+
+    this->newton_residual = 0.;
+
+    this->solve_linear_system();
+
+    TrilinosWrappers::MPI::Vector distributed_newton_solution(this->locally_owned_dofs, this->mpi_communicator);
+
+    distributed_newton_solution = this->newton_solution;
+
+    distributed_newton_solution -= this->newton_residual;
+
+    this->newton_solution = distributed_newton_solution;
+
+    return this->newton_residual.l2_norm()/distributed_newton_solution.l2_norm();
+  }
+
+  /*! Iterate the Newton method to solve the nonlinear problem */
+  template<int dim>
+  bool DistributedPhaseflow<dim>::solve_nonlinear_problem()
+  {
+    this->newton_solution = this->solution;
+
+    bool converged = false;
+
+    unsigned int i;
+
+    double old_norm_residual = 1.e32;
+
+    for (i = 0; i < this->params.nonlinear_solver.max_iterations; ++i)
+    {
+        const double norm_residual = this->step_newton();
+
+        this->pcout << "Newton iteration: L2 norm of relative residual, || w_w || / || w_k || = " << norm_residual << std::endl;
+
+        if (norm_residual > old_norm_residual)
+        {
+            this->pcout << "Newton iteration diverged." << std::endl;
+
+            break;
+        }
+
+        old_norm_residual = norm_residual;
+
+        if (norm_residual < this->params.nonlinear_solver.tolerance)
+        {
+            converged = true;
+
+            break;
+        }
+    }
+
+    if (!converged)
+    {
+        AssertThrow(this->time_step_size > this->params.time.min_step_size,
+            ExcMessage("The Newton method did not converge with the minimum time step size."));
+
+        return converged;
+    }
+
+    this->pcout << "Newton method converged after " << i + 1 << " iterations." << std::endl;
+
+    this->solution = this->newton_solution;
+
+    return converged;
+  }
+
+  template<int dim>
+  void DistributedPhaseflow<dim>::set_time_step_size(const double _new_size)
+  {
+    double new_size = std::min(
+        std::max(_new_size, this->params.time.min_step_size),
+        this->params.time.max_step_size);
+
+    if ((this->time + new_size) > this->params.time.end)
+    {
+        new_size = this->params.time.end - this->time;
+    }
+
+    if (numbers::NumberTraits<double>::abs(new_size - this->time_step_size) > this->params.time.epsilon)
+    {
+        this->pcout << "Set time step to deltat = " << new_size << std::endl;
+    }
+
+    this->time_step_size = new_size;
+  }
+
+  /*! Step the simulation from the current time step to the next time step; see Phaseflow<dim>::step_time. */
+  template<int dim>
+  void DistributedPhaseflow<dim>::step_time()
+  {
+    if (this->params.time.integrator == "BDF2")
+    {
+        this->old_old_solution = this->old_solution;
+    }
+
+    this->old_solution = this->solution;
+
+    bool converged;
+
+    do
+    {
+        this->new_time = this->time + this->time_step_size;
+
+        converged = this->solve_nonlinear_problem();
+
+        if (!converged)
+        {
+            this->set_time_step_size(this->time_step_size/this->params.time.growth_rate);
+        }
+
+    } while (!converged);
+
+    this->time = this->new_time;
+
+    this->old_time_step_size = this->time_step_size;
+
+    this->pcout << "Reached time t = " << this->time << std::endl;
+
+    if (this->time >= (this->params.time.end - this->params.time.epsilon))
+    {
+        return;
+    }
+
+    this->set_time_step_size(this->params.time.growth_rate*this->time_step_size);
+  }
+
+  /*! Compute || w_{n+1} - w_n || / || w_{n+1} || from the locally owned entries */
+  template<int dim>
+  double DistributedPhaseflow<dim>::compute_unsteadiness() const
+  {
+    TrilinosWrappers::MPI::Vector distributed_solution(this->locally_owned_dofs, this->mpi_communicator);
+
+    distributed_solution = this->solution;
+
+    TrilinosWrappers::MPI::Vector time_residual(this->locally_owned_dofs, this->mpi_communicator);
+
+    time_residual = this->old_solution;
+
+    time_residual.sadd(-1., distributed_solution);
+
+    return time_residual.l2_norm()/distributed_solution.l2_norm();
+  }
+
+  /*! Write the locally owned part of the solution from every process, and a parallel record from the first process */
+  template<int dim>
+  void DistributedPhaseflow<dim>::write_solution()
+  {
+    if (!this->params.output.write_solution_vtk)
+    {
+        return;
+    }
+
+    std::vector<std::string> solution_names(dim, "velocity");
+
+    solution_names.push_back("pressure");
+
+    solution_names.push_back("temperature");
+
+    std::vector<DataComponentInterpretation::DataComponentInterpretation>
+        data_component_interpretation(dim, DataComponentInterpretation::component_is_part_of_vector);
+
+    data_component_interpretation.push_back(DataComponentInterpretation::component_is_scalar);
+
+    data_component_interpretation.push_back(DataComponentInterpretation::component_is_scalar);
+
+    DataOut<dim> data_out;
+
+    data_out.attach_dof_handler(this->dof_handler);
+
+    data_out.add_data_vector(
+        this->solution,
+        solution_names,
+        DataOut<dim>::type_dof_data,
+        data_component_interpretation);
+
+    Vector<float> subdomain(this->triangulation.n_active_cells());
+
+    for (unsigned int i = 0; i < subdomain.size(); ++i)
+    {
+        subdomain(i) = this->triangulation.locally_owned_subdomain();
+    }
+
+    data_out.add_data_vector(subdomain, "subdomain");
+
+    data_out.build_patches();
+
+    const std::string file_name = Parameters::output_path(
+        this->params.output,
+        "solution-" + Utilities::int_to_string(this->time_step_counter) + ".vtu");
+
+    data_out.write_vtu_in_parallel(file_name.c_str(), this->mpi_communicator);
+  }
+
+  template<int dim>
+  void DistributedPhaseflow<dim>::run(const std::string parameter_file)
+  {
+    this->params = Parameters::read<dim>(
+        parameter_file,
+        this->source_function,
+        this->initial_values_function,
+        this->boundary_function,
+        this->exact_solution_function,
+        /* write_log = */ Utilities::MPI::this_mpi_process(this->mpi_communicator) == 0);
+
+    this->assert_supported_parameters();
+
+    MyGridGenerator::create_coarse_grid(
+        this->triangulation,
+        this->manifold_ids,
+        this->manifold_descriptors,
+        this->boundary_count,
+        this->params.geometry.grid_name,
+        this->params.geometry.sizes);
+
+    SphericalManifold<dim> spherical_manifold;
+
+    for (unsigned int i = 0; i < this->manifold_ids.size(); i++)
+    {
+        if (this->manifold_descriptors[i] == "spherical")
+        {
+            this->triangulation.set_manifold(this->manifold_ids[i], spherical_manifold);
+        }
+    }
+
+    this->triangulation.refine_global(this->params.refinement.initial_global_cycles);
+
+    this->setup_system();
+
+    this->time = 0.;
+
+    this->set_time_step_size(this->params.time.initial_step_size);
+
+    this->old_time_step_size = 0.;
+
+    this->time_step_counter = 0;
+
+    {
+        TrilinosWrappers::MPI::Vector distributed_solution(this->locally_owned_dofs, this->mpi_communicator);
+
+        VectorTools::interpolate(
+            this->dof_handler,
+            this->initial_values_function,
+            distributed_solution);
+
+        this->solution = distributed_solution;
+    }
+
+    this->write_solution();
+
+    for (this->time_step_counter = 1; this->time_step_counter < this->params.time.max_steps; ++this->time_step_counter)
+    {
+        if (this->time > (this->params.time.end*(1. - this->params.time.epsilon) - this->params.time.epsilon))
+        {
+            break;
+        }
+
+        this->step_time();
+
+        this->write_solution();
+
+        if (this->params.time.stop_when_steady)
+        {
+            const double unsteadiness = this->compute_unsteadiness();
+
+            this->pcout << "Unsteadiness, || w_{n+1} - w_n || / || w_{n+1} || = " << unsteadiness << std::endl;
+
+            if (unsteadiness < this->params.time.steady_tolerance)
+            {
+                this->pcout << "Reached steady state." << std::endl;
+
+                break;
+            }
+        }
+    }
+
+    /* Manifolds must be detached from Triangulations before leaving this scope. */
+    this->triangulation.set_manifold(0);
+  }
+
+}
+
+#endif
+
+#endif
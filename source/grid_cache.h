@@ -0,0 +1,282 @@
+#ifndef _grid_cache_h_
+#define _grid_cache_h_
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <deal.II/base/types.h>
+#include <deal.II/grid/tria.h>
+#include <deal.II/lac/sparsity_pattern.h>
+
+#include "pf_parameters.h"
+
+/*!
+@brief Cache of the initial setup, shared by runs with the same geometry, refinement and renumbering.
+
+@detail
+
+    In parameter studies which only vary the physics, every run would otherwise repeat
+    the grid generation, the global refinement, the DoF renumbering and the construction of the sparsity pattern.
+
+    An entry stores the refined triangulation, the permutation which the renumbering applied
+    to the DoFs that distribute_dofs enumerates, and the sparsity pattern.
+    Since distribute_dofs is deterministic for a given triangulation, applying the stored permutation
+    reproduces the DoF numbering, without repeating the renumbering methods.
+
+    The entries are kept in memory for the lifetime of the process, so that the cases of a batch run share them,
+    and optionally in a directory, so that separate processes share them.
+*/
+namespace Phaseflow
+{
+    namespace GridCache
+    {
+        using namespace dealii;
+
+        struct Entry
+        {
+            /*! The geometry, refinement and renumbering parameters and the finite element, from make_key */
+            std::string key;
+
+            unsigned int boundary_count;
+
+            std::vector<unsigned int> manifold_ids;
+
+            std::vector<std::string> manifold_descriptors;
+
+            /*! Serialized triangulation */
+            std::string triangulation;
+
+            /*! New index of each DoF as enumerated by distribute_dofs */
+            std::vector<types::global_dof_index> dof_renumbering;
+
+            /*! Sparsity pattern from SparsityPattern::block_write */
+            std::string sparsity_pattern;
+
+            template<int dim>
+            void save_triangulation(const Triangulation<dim> &_triangulation)
+            {
+                std::ostringstream out;
+
+                {
+                    boost::archive::binary_oarchive archive(out);
+
+                    archive << _triangulation;
+                }
+
+                this->triangulation = out.str();
+            }
+
+            /*! Manifolds are not serialized, so they must be attached again afterward */
+            template<int dim>
+            void load_triangulation(Triangulation<dim> &_triangulation) const
+            {
+                std::istringstream in(this->triangulation);
+
+                boost::archive::binary_iarchive archive(in);
+
+                archive >> _triangulation;
+            }
+
+            void save_sparsity_pattern(const SparsityPattern &_sparsity_pattern)
+            {
+                std::ostringstream out;
+
+                _sparsity_pattern.block_write(out);
+
+                this->sparsity_pattern = out.str();
+            }
+
+            void load_sparsity_pattern(SparsityPattern &_sparsity_pattern) const
+            {
+                std::istringstream in(this->sparsity_pattern);
+
+                _sparsity_pattern.block_read(in);
+            }
+
+            template<class Archive>
+            void serialize(Archive &archive, const unsigned int)
+            {
+                archive & this->key
+                    & this->boundary_count
+                    & this->manifold_ids
+                    & this->manifold_descriptors
+                    & this->triangulation
+                    & this->dof_renumbering
+                    & this->sparsity_pattern;
+            }
+        };
+
+        /*! Make the key of the parameters which determine the initial setup */
+        std::string make_key(const Parameters::StructuredParameters &params, const std::string &fe_name)
+        {
+            std::ostringstream key;
+
+            key << std::setprecision(17)
+                << fe_name
+                << "; grid_name = " << params.geometry.grid_name
+                << "; sizes =";
+
+            for (auto size : params.geometry.sizes)
+            {
+                key << " " << size;
+            }
+
+            key << "; initial_global_cycles = " << params.refinement.initial_global_cycles
+                << "; initial_boundary_cycles = " << params.refinement.initial_boundary_cycles
+                << "; boundaries_to_refine =";
+
+            for (auto boundary : params.refinement.boundaries_to_refine)
+            {
+                key << " " << boundary;
+            }
+
+            key << "; renumbering =";
+
+            for (auto method : params.renumbering.methods)
+            {
+                key << " " << method;
+            }
+
+            key << "; downstream_direction =";
+
+            for (auto component : params.renumbering.downstream_direction)
+            {
+                key << " " << component;
+            }
+
+            return key.str();
+        }
+
+        /*! Get the file of an entry in the cache directory, named by the hash of its key */
+        std::string get_file_name(const std::string &directory, const std::string &key)
+        {
+            std::ostringstream file_name;
+
+            file_name << directory << "/grid_cache_" << std::hex << std::hash<std::string>()(key) << ".bin";
+
+            return file_name.str();
+        }
+
+        /*! Entries in memory, which are shared by all runs in the process */
+        std::map<std::string, std::shared_ptr<const Entry>> &get_memory()
+        {
+            static std::map<std::string, std::shared_ptr<const Entry>> memory;
+
+            return memory;
+        }
+
+        std::mutex &get_mutex()
+        {
+            static std::mutex mutex;
+
+            return mutex;
+        }
+
+        /*! Find the entry with the given key in memory, or else in the directory. Returns null if there is none. */
+        std::shared_ptr<const Entry> find(const std::string &directory, const std::string &key)
+        {
+            {
+                std::lock_guard<std::mutex> lock(get_mutex());
+
+                const auto entry = get_memory().find(key);
+
+                if (entry != get_memory().end())
+                {
+                    return entry->second;
+                }
+            }
+
+            if (directory.empty())
+            {
+                return nullptr;
+            }
+
+            std::ifstream file(get_file_name(directory, key), std::ios::binary);
+
+            if (!file.good())
+            {
+                return nullptr;
+            }
+
+            std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+
+            {
+                boost::archive::binary_iarchive archive(file);
+
+                archive >> *entry;
+            }
+
+            /* Different keys could have the same hash. */
+            if (entry->key != key)
+            {
+                return nullptr;
+            }
+
+            std::lock_guard<std::mutex> lock(get_mutex());
+
+            get_memory()[key] = entry;
+
+            return entry;
+        }
+
+        /*!
+        @brief Insert the entry in memory, and write it to the directory unless the directory is empty.
+
+        @detail
+
+            The file is first written under a temporary name and then renamed,
+            so that concurrent processes never read a partially written entry.
+        */
+        void insert(const std::string &directory, const std::shared_ptr<const Entry> entry)
+        {
+            {
+                std::lock_guard<std::mutex> lock(get_mutex());
+
+                get_memory()[entry->key] = entry;
+            }
+
+            if (directory.empty())
+            {
+                return;
+            }
+
+            const std::string file_name = get_file_name(directory, entry->key);
+
+            std::ostringstream temporary_file_name;
+
+            temporary_file_name << file_name << "." << getpid() << "." << std::this_thread::get_id() << ".tmp";
+
+            {
+                std::ofstream file(temporary_file_name.str(), std::ios::binary);
+
+                AssertThrow(file.good(), ExcMessage("Could not write the grid cache file " + temporary_file_name.str()));
+
+                boost::archive::binary_oarchive archive(file);
+
+                archive << *entry;
+            }
+
+            std::rename(temporary_file_name.str().c_str(), file_name.c_str());
+        }
+
+    }
+
+}
+
+#endif
@@ -1,9 +1,25 @@
+#include <deal.II/base/mpi.h>
+
 #include "phaseflow.h"
 
+#include "distributed_phaseflow.h"
+
+#include "batch.h"
+
 int main(int argc, char* argv[])
 {
     try
     {   
+        dealii::Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, dealii::numbers::invalid_unsigned_int);
+        
+        if ((argc > 1) && (std::string(argv[1]) == "--batch"))
+        {
+            AssertThrow(dealii::Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD) == 1,
+                dealii::ExcMessage("The batch mode runs all cases in one process."));
+            
+            return Phaseflow::Batch::run_command_line(argc, argv);
+        }
+        
         std::string parameter_input_file_path = "";
         
         if (argc == 2)
@@ -14,23 +30,53 @@ int main(int argc, char* argv[])
         Phaseflow::Parameters::Meta mp = 
             Phaseflow::Parameters::read_meta_parameters(parameter_input_file_path);
         
-         /*
+        if (mp.distributed | (dealii::Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD) > 1))
+        {
+#if defined(DEAL_II_WITH_P4EST) && defined(DEAL_II_WITH_TRILINOS)
+            switch (mp.dim)
+            {
+                case 2:
+                {
+                    Phaseflow::DistributedPhaseflow<2> distributed_pf_2D;
+                    distributed_pf_2D.run(parameter_input_file_path);
+                    break;
+                }
+                case 3:
+                {
+                    Phaseflow::DistributedPhaseflow<3> distributed_pf_3D;
+                    distributed_pf_3D.run(parameter_input_file_path);
+                    break;
+                }
+                default:
+                    Assert(false, dealii::ExcNotImplemented());
+                    break;
+            }
+            
+            return 0;
+#else
+            AssertThrow(false, dealii::ExcMessage(
+                "The distributed model requires deal.II to be configured with p4est and Trilinos."));
+#endif
+        }
+        
+        /*
         Only a compile time constant can be used as the template arguments to insantiate the model,
-        so we must instantiate each possible dimensionality. This is virtually free, since of course
-        data will only be generated for one of these models.
+        so we must compile each possible dimensionality; but only the model of the selected dimension is constructed.
         */
-        Phaseflow::Phaseflow<2> pf_2D;
-        Phaseflow::Phaseflow<3> pf_3D;
-
         switch (mp.dim)
         {
             case 2:
+            {
+                Phaseflow::Phaseflow<2> pf_2D;
                 pf_2D.run(parameter_input_file_path);
                 break;
-            
+            }
             case 3:
+            {
+                Phaseflow::Phaseflow<3> pf_3D;
                 pf_3D.run(parameter_input_file_path);
                 break;
+            }
             
             default:
                 Assert(false, dealii::ExcNotImplemented());
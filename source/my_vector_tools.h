@@ -0,0 +1,32 @@
+#ifndef _my_vector_tools_h_
+#define _my_vector_tools_h_
+
+#include <cmath>
+
+#include <deal.II/lac/vector.h>
+
+namespace MyVectorTools
+{
+    using namespace dealii;
+
+    /*! Compute || a - b || in a single pass, without allocating a vector for the difference */
+    template<typename Number>
+    Number l2_norm_of_difference(const Vector<Number> &a, const Vector<Number> &b)
+    {
+        Assert(a.size() == b.size(), ExcDimensionMismatch(a.size(), b.size()));
+
+        Number sum_of_squares = 0.;
+
+        for (types::global_dof_index i = 0; i < a.size(); ++i)
+        {
+            const Number difference = a[i] - b[i];
+
+            sum_of_squares += difference*difference;
+        }
+
+        return std::sqrt(sum_of_squares);
+    }
+
+}
+
+#endif
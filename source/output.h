@@ -50,17 +50,21 @@ namespace Output
         data_out.write_vtk(output);
     }  
     
-    void write_linear_system(SparseMatrix<double> &A, Vector<double> &b)
+    void write_linear_system(
+        SparseMatrix<double> &A,
+        Vector<double> &b,
+        const std::string matrix_file_name = "A.txt",
+        const std::string rhs_file_name = "b.txt")
     {
         
         {
-            std::ofstream output("A.txt");
+            std::ofstream output(matrix_file_name);
         
             A.print(output);
         }
         
         {
-            std::ofstream output("b.txt");
+            std::ofstream output(rhs_file_name);
         
             b.print(output);
         }
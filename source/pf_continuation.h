@@ -0,0 +1,84 @@
+#ifndef _pf_continuation_h_
+#define _pf_continuation_h_
+
+/*!
+@brief Step a physics parameter through a schedule of values, warm starting each solve.
+
+@detail
+
+    Problems such as natural convection at high Rayleigh number often do not converge
+    from the initial values. Instead, we solve a sequence of easier problems, using the
+    solution of each as the initial guess for the next.
+
+    All stages reuse the grid, the degrees of freedom and the sparsity pattern,
+    so that only the first stage pays for grid generation and setup_system().
+
+    Returns whether every stage converged.
+*/
+template<int dim>
+bool Phaseflow<dim>::run_continuation()
+{
+    const Parameters::Continuation continuation = this->params.continuation;
+
+    bool converged = false;
+
+    for (unsigned int stage = 0; stage < continuation.values.size(); ++stage)
+    {
+        const double value = continuation.values[stage];
+
+        if (continuation.parameter == "rayleigh_number")
+        {
+            this->params.physics.rayleigh_number = value;
+        }
+        else if (continuation.parameter == "liquid_dynamic_viscosity")
+        {
+            this->params.physics.liquid_dynamic_viscosity = value;
+        }
+        else
+        {
+            AssertThrow(false, ExcNotImplemented());
+        }
+
+        this->continuation_stage = stage + 1;
+
+        this->out << "Continuation stage " << this->continuation_stage << ": "
+            << continuation.parameter << " = " << value << std::endl;
+
+        if (stage > 0) /* Restart the clock, but keep the solution from the previous stage as the initial values. */
+        {
+            this->time = 0.;
+
+            this->set_time_step_size(this->params.time.initial_step_size);
+            
+            this->old_time_step_size = 0.;
+            
+            this->old_old_time_step_size = 0.;
+        }
+
+        converged = this->solve_problem();
+
+        this->continuation_table.add_value("stage", this->continuation_stage);
+        this->continuation_table.add_value(continuation.parameter, value);
+        this->continuation_table.add_value("time", this->time);
+        this->continuation_table.add_value("converged", std::string(converged ? "true" : "false"));
+
+        if (!converged)
+        {
+            this->out << "Stopped continuation, since stage " << this->continuation_stage
+                << " did not converge." << std::endl;
+
+            break;
+        }
+    }
+
+    this->continuation_table.set_scientific(continuation.parameter, true);
+
+    std::ofstream out_file(this->output_path("continuation_table.txt"));
+    AssertThrow(out_file.good(), ExcIO());
+    this->continuation_table.write_text(out_file);
+    out_file.close();
+
+    return converged;
+}
+
+#endif
@@ -0,0 +1,930 @@
+#ifndef _pf_local_assembly_h_
+#define _pf_local_assembly_h_
+
+#include <algorithm>
+#include <cmath>
+
+#include <deal.II/base/function.h>
+#include <deal.II/base/tensor.h>
+#include <deal.II/base/vectorization.h>
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/vector.h>
+#include <deal.II/fe/fe_values.h>
+
+#include "pf_parameters.h"
+
+/*!
+    @brief Cell-wise assembly of the Newton linearized Navier-Stokes-Boussinesq system.
+
+    @detail
+
+        The cell kernel is shared by the serial Phaseflow model and by the distributed model,
+        which only differ in how they loop over cells and where they put the local contributions.
+        It is templated on the vector type, so that it works with ghosted distributed vectors.
+*/
+namespace Phaseflow
+{
+    namespace LocalAssembly
+    {
+        using namespace dealii;
+
+        /*! Parameters of the linearized system which are constant during one assembly */
+        template<int dim>
+        struct Coefficients
+        {
+            double Ra;
+            double Pr;
+            double Re;
+            double K;
+            Tensor<1, dim> g;
+            double mu_l;
+            double gamma;
+            double deltat;
+            double alpha_0;
+            double alpha_1;
+            double alpha_2;
+            double newton_terms;
+            
+            /*! If false, then the local matrix only gets the terms which depend on the Newton iterate */
+            bool linear_terms;
+
+            /*! Parameters of the regularized phase-change model, which are only used if phase_change is true */
+            bool phase_change;
+            double Ste;
+            double mu_s;
+            double theta_r;
+            double r;
+        };
+
+        /*!
+        @brief Get the coefficients of the time derivative approximation
+
+            $(\alpha_0 w_{n+1} + \alpha_1 w_n + \alpha_2 w_{n-1})/\Delta t_n$.
+
+        @detail
+
+            For variable step BDF2, with the step size ratio $\omega = \Delta t_n / \Delta t_{n-1}$,
+
+                $\alpha_0 = (1 + 2\omega)/(1 + \omega)$,
+                $\alpha_1 = -(1 + \omega)$,
+                $\alpha_2 = \omega^2/(1 + \omega)$.
+
+            Otherwise this is backward Euler.
+        */
+        void get_time_derivative_coefficients(
+            const bool bdf2,
+            const double deltat,
+            const double old_deltat,
+            double &alpha_0,
+            double &alpha_1,
+            double &alpha_2)
+        {
+            if (bdf2)
+            {
+                const double omega = deltat/old_deltat;
+
+                alpha_0 = (1. + 2.*omega)/(1. + omega);
+
+                alpha_1 = -(1. + omega);
+
+                alpha_2 = omega*omega/(1. + omega);
+
+                return;
+            }
+
+            alpha_0 = 1.;
+
+            alpha_1 = -1.;
+
+            alpha_2 = 0.;
+        }
+
+        template<int dim>
+        Coefficients<dim> make_coefficients(
+            const Parameters::StructuredParameters &params,
+            const double deltat,
+            const double alpha_0,
+            const double alpha_1,
+            const double alpha_2,
+            const bool picard)
+        {
+            const double PENALTY = 1.e-7; // @todo: Expose this to ParameterHandler.
+
+            Coefficients<dim> coefficients;
+
+            coefficients.Ra = params.physics.rayleigh_number;
+
+            coefficients.Pr = params.physics.prandtl_number;
+
+            coefficients.Re = REYNOLDS_NUMBER;
+
+            coefficients.K = params.physics.solid_conductivity/params.physics.liquid_conductivity;
+
+            for (unsigned int i = 0; i < dim; ++i)
+            {
+                coefficients.g[i] = params.physics.gravity[i];
+            }
+
+            coefficients.mu_l = params.physics.liquid_dynamic_viscosity;
+
+            coefficients.gamma = PENALTY;
+
+            coefficients.deltat = deltat;
+
+            coefficients.alpha_0 = alpha_0;
+
+            coefficients.alpha_1 = alpha_1;
+
+            coefficients.alpha_2 = alpha_2;
+
+            /*!
+                The Picard linearization freezes the convective velocity at the previous iterate,
+                which drops the derivatives of the trilinear terms with respect to that velocity.
+            */
+            coefficients.newton_terms = picard ? 0. : 1.;
+
+            coefficients.linear_terms = true;
+
+            coefficients.phase_change = params.physics.phase_change.enabled;
+
+            coefficients.Ste = params.physics.phase_change.stefan_number;
+
+            coefficients.mu_s = params.physics.phase_change.solid_dynamic_viscosity;
+
+            coefficients.theta_r = params.physics.phase_change.central_temperature;
+
+            coefficients.r = params.physics.phase_change.smoothing_parameter;
+
+            return coefficients;
+        }
+
+        /*! Check if two sets of coefficients give the same terms of the Jacobian which do not depend on the Newton iterate, except for the time derivative */
+        template<int dim>
+        bool have_same_linear_terms(const Coefficients<dim> &c1, const Coefficients<dim> &c2)
+        {
+            return (c1.Ra == c2.Ra) && (c1.Pr == c2.Pr) && (c1.Re == c2.Re) && (c1.K == c2.K)
+                && (c1.g == c2.g) && (c1.mu_l == c2.mu_l) && (c1.gamma == c2.gamma)
+                && (c1.phase_change == c2.phase_change);
+        }
+
+        /*! Check if the local matrices assembled with two sets of coefficients are the same for the same iterate */
+        template<int dim>
+        bool have_same_jacobian(const Coefficients<dim> &c1, const Coefficients<dim> &c2)
+        {
+            if ((c1.linear_terms != c2.linear_terms) || (c1.newton_terms != c2.newton_terms))
+            {
+                return false;
+            }
+
+            if (!c1.linear_terms && !c1.phase_change) /* The convective terms have no coefficients. */
+            {
+                return true;
+            }
+
+            return have_same_linear_terms(c1, c2) && (c1.alpha_0 == c2.alpha_0) && (c1.deltat == c2.deltat)
+                && (c1.Ste == c2.Ste) && (c1.mu_s == c2.mu_s) && (c1.theta_r == c2.theta_r) && (c1.r == c2.r);
+        }
+
+        /*!
+        @brief Evaluate the regularized solid fraction, and optionally its derivative, at a list of temperatures.
+
+        @detail
+
+            The solid fraction is the smoothed Heaviside function
+
+                $\phi(\theta) = \frac{1}{2}\left[1 + \tanh\left(\frac{\theta_r - \theta}{r}\right)\right]$,
+
+            with the derivative $\phi'(\theta) = -\frac{1}{2r}\left[1 - \tanh^2\left(\frac{\theta_r - \theta}{r}\right)\right]$.
+
+            The temperatures are processed in batches of VectorizedArray<double>, with
+            $\tanh(x) = 1 - 2/(\exp(2x) + 1)$, which also gives the correct limits
+            when the exponential overflows or underflows.
+        */
+        inline void evaluate_solid_fraction(
+            const std::vector<double> &theta,
+            const double theta_r,
+            const double r,
+            std::vector<double> &phi,
+            std::vector<double> *dphi_dtheta = nullptr)
+        {
+            const unsigned int width = VectorizedArray<double>::n_array_elements;
+
+            const unsigned int n = theta.size();
+
+            for (unsigned int first = 0; first < n; first += width)
+            {
+                const unsigned int n_lanes = std::min(width, n - first);
+
+                VectorizedArray<double> x;
+
+                x = 0.;
+
+                for (unsigned int l = 0; l < n_lanes; ++l)
+                {
+                    x[l] = (theta_r - theta[first + l])/r;
+                }
+
+                const VectorizedArray<double> tanh_x = 1. - 2./(std::exp(2.*x) + 1.);
+
+                const VectorizedArray<double> phi_x = 0.5*(1. + tanh_x);
+
+                const VectorizedArray<double> dphi_x = (-0.5/r)*(1. - tanh_x*tanh_x);
+
+                for (unsigned int l = 0; l < n_lanes; ++l)
+                {
+                    phi[first + l] = phi_x[l];
+
+                    if (dphi_dtheta)
+                    {
+                        (*dphi_dtheta)[first + l] = dphi_x[l];
+                    }
+                }
+            }
+        }
+
+        /*! Bilinear form of the viscous stress, in the notation of Danaila 2014 */
+        template<int dim>
+        double a(
+            const double _mu,
+            const Tensor<2, dim> _gradu,
+            const Tensor<2, dim> _gradv)
+        {
+            auto D = [](
+                const Tensor<2, dim> _gradw)
+            {
+                return 0.5*(_gradw + transpose(_gradw));
+            };
+
+            return 2.*_mu*scalar_product(D(_gradu), D(_gradv));
+        }
+
+        /*! Bilinear form of the incompressibility constraint, in the notation of Danaila 2014 */
+        inline double b(
+            const double _divu,
+            const double _q)
+        {
+            return -_divu*_q;
+        }
+
+        /*! Work arrays for the cell kernel, allocated once per assembly */
+        template<int dim>
+        struct ScratchData
+        {
+            ScratchData(const unsigned int n_quad_points, const unsigned int dofs_per_cell)
+                :
+                old_velocity_values(n_quad_points),
+                old_temperature_values(n_quad_points),
+                old_old_velocity_values(n_quad_points),
+                old_old_temperature_values(n_quad_points),
+                old_newton_velocity_values(n_quad_points),
+                old_newton_pressure_values(n_quad_points),
+                old_newton_temperature_values(n_quad_points),
+                old_newton_velocity_gradients(n_quad_points),
+                old_newton_temperature_gradients(n_quad_points),
+                old_newton_velocity_divergences(n_quad_points),
+                source_values(n_quad_points, Vector<double>(dim + 2)),
+                solid_fraction_values(n_quad_points),
+                solid_fraction_derivatives(n_quad_points),
+                old_solid_fraction_values(n_quad_points),
+                old_old_solid_fraction_values(n_quad_points),
+                old_local_values(dofs_per_cell),
+                old_old_local_values(dofs_per_cell),
+                old_newton_local_values(dofs_per_cell),
+                velocity_fe_values(dofs_per_cell),
+                pressure_fe_values(dofs_per_cell),
+                temperature_fe_values(dofs_per_cell),
+                grad_temperature_fe_values(dofs_per_cell),
+                grad_velocity_fe_values(dofs_per_cell),
+                div_velocity_fe_values(dofs_per_cell),
+                all_dofs(dofs_per_cell)
+            {
+                for (unsigned int i = 0; i < dofs_per_cell; ++i)
+                {
+                    all_dofs[i] = i;
+                }
+            }
+
+            std::vector<Tensor<1, dim>> old_velocity_values;
+
+            std::vector<double> old_temperature_values;
+
+            std::vector<Tensor<1, dim>> old_old_velocity_values;
+
+            std::vector<double> old_old_temperature_values;
+
+            std::vector<Tensor<1, dim>> old_newton_velocity_values;
+
+            std::vector<double> old_newton_pressure_values;
+
+            std::vector<double> old_newton_temperature_values;
+
+            std::vector<Tensor<2, dim>> old_newton_velocity_gradients;
+
+            std::vector<Tensor<1, dim>> old_newton_temperature_gradients;
+
+            std::vector<double> old_newton_velocity_divergences;
+
+            std::vector<Vector<double>> source_values;
+
+            std::vector<double> solid_fraction_values;
+
+            std::vector<double> solid_fraction_derivatives;
+
+            std::vector<double> old_solid_fraction_values;
+
+            std::vector<double> old_old_solid_fraction_values;
+
+            Vector<double> old_local_values;
+
+            Vector<double> old_old_local_values;
+
+            Vector<double> old_newton_local_values;
+
+            std::vector<Tensor<1, dim>> velocity_fe_values;
+
+            std::vector<double> pressure_fe_values;
+
+            std::vector<double> temperature_fe_values;
+
+            std::vector<Tensor<1, dim>> grad_temperature_fe_values;
+
+            std::vector<Tensor<2, dim>> grad_velocity_fe_values;
+
+            std::vector<double> div_velocity_fe_values;
+
+            /*! The local indices of all DoFs of the cell, i.e. 0, 1, ..., dofs_per_cell - 1 */
+            std::vector<unsigned int> all_dofs;
+        };
+
+        /*!
+        @brief Evaluate the fields of the gathered local DoF values at all quadrature points in one pass.
+
+        @detail
+
+            This replaces the separate get_function_values, get_function_gradients and
+            get_function_divergences calls per vector and field, which each loop over
+            all shape functions and quadrature points again.
+            The sums are accumulated over the shape functions in the same order as deal.II does,
+            so that the results are identical.
+
+            The old old values are only evaluated if they are used, i.e. for BDF2.
+        */
+        template<int dim, typename CellValuesType>
+        void evaluate_fields(
+            const CellValuesType &fe_values,
+            const FEValuesExtractors::Vector &velocity_extractor,
+            const FEValuesExtractors::Scalar &pressure_extractor,
+            const FEValuesExtractors::Scalar &temperature_extractor,
+            const bool with_old_old,
+            ScratchData<dim> &scratch)
+        {
+            const FiniteElement<dim> &fe = fe_values.get_fe();
+
+            const unsigned int dofs_per_cell = fe_values.dofs_per_cell;
+
+            const unsigned int n_quad_points = fe_values.n_quadrature_points;
+
+            const unsigned int first_velocity_component = velocity_extractor.first_vector_component;
+
+            for (unsigned int quad = 0; quad < n_quad_points; ++quad)
+            {
+                Tensor<1, dim> u_n, u_nminus1, u_k, gradtheta_k;
+
+                Tensor<2, dim> gradu_k;
+
+                double theta_n = 0., theta_nminus1 = 0., p_k = 0., theta_k = 0., divu_k = 0.;
+
+                for (unsigned int i = 0; i < dofs_per_cell; ++i)
+                {
+                    const unsigned int component = fe.system_to_component_index(i).first;
+
+                    const double shape_value = fe_values.shape_value(i, quad);
+
+                    const Tensor<1, dim> &shape_grad = fe_values.shape_grad(i, quad);
+
+                    const double w_n = scratch.old_local_values[i];
+
+                    const double w_k = scratch.old_newton_local_values[i];
+
+                    if ((component >= first_velocity_component)
+                        && (component < first_velocity_component + dim))
+                    {
+                        const unsigned int d = component - first_velocity_component;
+
+                        u_n[d] += w_n*shape_value;
+
+                        if (with_old_old)
+                        {
+                            u_nminus1[d] += scratch.old_old_local_values[i]*shape_value;
+                        }
+
+                        u_k[d] += w_k*shape_value;
+
+                        gradu_k[d] += w_k*shape_grad;
+
+                        divu_k += w_k*shape_grad[d];
+                    }
+                    else if (component == pressure_extractor.component)
+                    {
+                        p_k += w_k*shape_value;
+                    }
+                    else if (component == temperature_extractor.component)
+                    {
+                        theta_n += w_n*shape_value;
+
+                        if (with_old_old)
+                        {
+                            theta_nminus1 += scratch.old_old_local_values[i]*shape_value;
+                        }
+
+                        theta_k += w_k*shape_value;
+
+                        gradtheta_k += w_k*shape_grad;
+                    }
+                }
+
+                scratch.old_velocity_values[quad] = u_n;
+
+                scratch.old_temperature_values[quad] = theta_n;
+
+                if (with_old_old)
+                {
+                    scratch.old_old_velocity_values[quad] = u_nminus1;
+
+                    scratch.old_old_temperature_values[quad] = theta_nminus1;
+                }
+
+                scratch.old_newton_velocity_values[quad] = u_k;
+
+                scratch.old_newton_pressure_values[quad] = p_k;
+
+                scratch.old_newton_temperature_values[quad] = theta_k;
+
+                scratch.old_newton_velocity_gradients[quad] = gradu_k;
+
+                scratch.old_newton_temperature_gradients[quad] = gradtheta_k;
+
+                scratch.old_newton_velocity_divergences[quad] = divu_k;
+            }
+        }
+
+        /*!
+        @brief Tabulate the values, gradients and divergences of the shape functions of each field at one quadrature point.
+
+        @detail
+
+            Every shape function of the primitive finite element is nonzero in only one component,
+            so this is what the FEValuesViews would give, but it only needs the scalar shape values
+            and gradients, which are also available from a CellValuesCache.
+        */
+        template<int dim, typename CellValuesType>
+        void evaluate_shape_functions(
+            const CellValuesType &fe_values,
+            const FEValuesExtractors::Vector &velocity_extractor,
+            const FEValuesExtractors::Scalar &pressure_extractor,
+            const FEValuesExtractors::Scalar &temperature_extractor,
+            const unsigned int quad,
+            ScratchData<dim> &scratch)
+        {
+            const FiniteElement<dim> &fe = fe_values.get_fe();
+
+            const unsigned int first_velocity_component = velocity_extractor.first_vector_component;
+
+            for (unsigned int dof = 0; dof < fe_values.dofs_per_cell; ++dof)
+            {
+                const unsigned int component = fe.system_to_component_index(dof).first;
+
+                const double shape_value = fe_values.shape_value(dof, quad);
+
+                const Tensor<1, dim> &shape_grad = fe_values.shape_grad(dof, quad);
+
+                scratch.velocity_fe_values[dof] = Tensor<1, dim>();
+                scratch.pressure_fe_values[dof] = 0.;
+                scratch.temperature_fe_values[dof] = 0.;
+                scratch.grad_temperature_fe_values[dof] = Tensor<1, dim>();
+                scratch.grad_velocity_fe_values[dof] = Tensor<2, dim>();
+                scratch.div_velocity_fe_values[dof] = 0.;
+
+                if ((component >= first_velocity_component)
+                    && (component < first_velocity_component + dim))
+                {
+                    const unsigned int d = component - first_velocity_component;
+
+                    scratch.velocity_fe_values[dof][d] = shape_value;
+                    scratch.grad_velocity_fe_values[dof][d] = shape_grad;
+                    scratch.div_velocity_fe_values[dof] = shape_grad[d];
+                }
+                else if (component == pressure_extractor.component)
+                {
+                    scratch.pressure_fe_values[dof] = shape_value;
+                }
+                else if (component == temperature_extractor.component)
+                {
+                    scratch.temperature_fe_values[dof] = shape_value;
+                    scratch.grad_temperature_fe_values[dof] = shape_grad;
+                }
+            }
+        }
+
+        /*!
+        @brief Assemble the local matrices of the terms of the Jacobian which do not depend on the Newton iterate.
+
+        @detail
+
+            The time derivative's mass matrix is separate from the other terms,
+            so that it can be scaled by $\alpha_0/\Delta t$ for any time step size.
+
+            The Jacobian is then the sum of these and of the matrix which assemble_cell
+            assembles when coefficients.linear_terms is false.
+
+            With phase change, the viscous and diffusion terms depend on the temperature,
+            so they are left to assemble_cell.
+        */
+        template<int dim, typename CellValuesType>
+        void assemble_linear_cell(
+            const CellValuesType &fe_values,
+            const FEValuesExtractors::Vector &velocity_extractor,
+            const FEValuesExtractors::Scalar &pressure_extractor,
+            const FEValuesExtractors::Scalar &temperature_extractor,
+            const Coefficients<dim> &coefficients,
+            ScratchData<dim> &scratch,
+            FullMatrix<double> &local_mass_matrix,
+            FullMatrix<double> &local_linear_matrix)
+        {
+            const double
+                Ra = coefficients.Ra,
+                Pr = coefficients.Pr,
+                Re = coefficients.Re;
+
+            const double K = coefficients.K;
+
+            const double mu_l = coefficients.mu_l;
+
+            const double gamma = coefficients.gamma;
+
+            const Tensor<1, dim> df_B_over_dtheta(Ra/(Pr*Re*Re)*coefficients.g);
+
+            const unsigned int dofs_per_cell = fe_values.dofs_per_cell;
+
+            local_mass_matrix = 0.;
+
+            local_linear_matrix = 0.;
+
+            for (unsigned int quad = 0; quad < fe_values.n_quadrature_points; ++quad)
+            {
+                evaluate_shape_functions(
+                    fe_values,
+                    velocity_extractor,
+                    pressure_extractor,
+                    temperature_extractor,
+                    quad,
+                    scratch);
+
+                for (unsigned int i = 0; i < dofs_per_cell; ++i)
+                {
+                    const Tensor<1, dim> v = scratch.velocity_fe_values[i];
+                    const double q = scratch.pressure_fe_values[i];
+                    const double phi = scratch.temperature_fe_values[i];
+                    const Tensor<1, dim> gradphi = scratch.grad_temperature_fe_values[i];
+                    const Tensor<2, dim> gradv = scratch.grad_velocity_fe_values[i];
+                    const double divv = scratch.div_velocity_fe_values[i];
+
+                    for (unsigned int j = 0; j < dofs_per_cell; ++j)
+                    {
+                        const Tensor<1, dim> u_w = scratch.velocity_fe_values[j];
+                        const double p_w = scratch.pressure_fe_values[j];
+                        const double theta_w = scratch.temperature_fe_values[j];
+                        const Tensor<1, dim> gradtheta_w = scratch.grad_temperature_fe_values[j];
+                        const Tensor<2, dim> gradu_w = scratch.grad_velocity_fe_values[j];
+                        const double divu_w = scratch.div_velocity_fe_values[j];
+
+                        local_mass_matrix(i,j) += (
+                            scalar_product(u_w, v) + theta_w*phi
+                            )*fe_values.JxW(quad);
+
+                        local_linear_matrix(i,j) += (
+                            b(divu_w, q) - gamma*p_w*q // Mass
+                            + b(divv, p_w) // Momentum: Pressure
+                            + scalar_product(theta_w*df_B_over_dtheta, v) // Momentum: Bouyancy
+                            )*fe_values.JxW(quad);
+
+                        if (!coefficients.phase_change) /* Otherwise the viscosity and conductivity depend on the temperature. */
+                        {
+                            local_linear_matrix(i,j) += (
+                                a(mu_l, gradu_w, gradv) // Momentum: Viscous stress
+                                + scalar_product(K/Pr*gradtheta_w, gradphi) // Energy: Diffusion
+                                )*fe_values.JxW(quad);
+                        }
+                    }
+                }
+            }
+        }
+
+        /*!
+        @brief Assemble the local matrix and right hand side on the cell to which fe_values was reinitialized.
+
+        @detail
+
+            See Phaseflow<dim>::assemble_system for the formulation.
+
+            The local DoF values of each vector are gathered once via local_dof_indices,
+            and all fields are evaluated from them in a single pass over the quadrature points.
+
+            If assemble_matrix is false, then only the right hand side is assembled,
+            e.g. to reuse a cached local matrix.
+
+            If block_dofs is not null, then only the rows and columns of these local DoFs are assembled,
+            e.g. for the flow or energy subsystem of the segregated iterations. The other entries stay zero.
+
+            fe_values is either an FEValues object, or the CellValuesCache::CellValues of the cell.
+        */
+        template<int dim, typename CellValuesType, typename VectorType>
+        void assemble_cell(
+            const CellValuesType &fe_values,
+            const FEValuesExtractors::Vector &velocity_extractor,
+            const FEValuesExtractors::Scalar &pressure_extractor,
+            const FEValuesExtractors::Scalar &temperature_extractor,
+            const VectorType &old_solution,
+            const VectorType &old_old_solution,
+            const VectorType &old_newton_solution,
+            const std::vector<types::global_dof_index> &local_dof_indices,
+            const Function<dim> &source_function,
+            const Coefficients<dim> &coefficients,
+            ScratchData<dim> &scratch,
+            FullMatrix<double> &local_matrix,
+            Vector<double> &local_rhs,
+            const bool assemble_matrix = true,
+            const std::vector<unsigned int> *block_dofs = nullptr)
+        {
+            const double
+                Ra = coefficients.Ra,
+                Pr = coefficients.Pr,
+                Re = coefficients.Re;
+
+            const double K = coefficients.K;
+
+            const Tensor<1, dim> g = coefficients.g;
+
+            const double mu_l = coefficients.mu_l;
+
+            /*!
+             lambda function for classical (linear) Boussinesq bouyancy
+            */
+            auto f_B = [Ra, Pr, Re, g](const double _theta)
+            {
+                return _theta*Ra/(Pr*Re*Re)*g;
+            };
+
+            /*!
+             Analytical derivative of classical (linear) Boussinesq bouyancy
+            */
+            const Tensor<1, dim> df_B_over_dtheta(Ra/(Pr*Re*Re)*g);
+
+            /*!
+             lambda function for the trilinear operator
+            */
+            auto c = [](
+                const Tensor<1, dim> _w,
+                const Tensor<2, dim> _gradz,
+                const Tensor<1, dim> _v)
+            {
+                return (_v*_gradz)*_w;
+            };
+
+            /*!
+                Set local variables to match notation in Danaila 2014
+            */
+            const double deltat = coefficients.deltat;
+
+            const double
+                alpha_0 = coefficients.alpha_0,
+                alpha_1 = coefficients.alpha_1,
+                alpha_2 = coefficients.alpha_2;
+
+            const double gamma = coefficients.gamma;
+
+            const double newton_terms = coefficients.newton_terms;
+
+            const bool phase_change = coefficients.phase_change;
+
+            const double
+                Ste = coefficients.Ste,
+                mu_s = coefficients.mu_s;
+
+            const unsigned int dofs_per_cell = fe_values.dofs_per_cell;
+
+            const unsigned int n_quad_points = fe_values.n_quadrature_points;
+
+            const std::vector<unsigned int> &dofs = block_dofs ? *block_dofs : scratch.all_dofs;
+
+            const unsigned int n_matrix_dofs = assemble_matrix ? dofs.size() : 0;
+
+            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            {
+                scratch.old_local_values[i] = old_solution(local_dof_indices[i]);
+
+                scratch.old_newton_local_values[i] = old_newton_solution(local_dof_indices[i]);
+            }
+
+            if (alpha_2 != 0.)
+            {
+                for (unsigned int i = 0; i < dofs_per_cell; ++i)
+                {
+                    scratch.old_old_local_values[i] = old_old_solution(local_dof_indices[i]);
+                }
+            }
+
+            evaluate_fields(
+                fe_values,
+                velocity_extractor,
+                pressure_extractor,
+                temperature_extractor,
+                alpha_2 != 0.,
+                scratch);
+
+            if (phase_change) /* Batch the transcendental functions for all quadrature points */
+            {
+                evaluate_solid_fraction(
+                    scratch.old_newton_temperature_values,
+                    coefficients.theta_r, coefficients.r,
+                    scratch.solid_fraction_values,
+                    &scratch.solid_fraction_derivatives);
+
+                evaluate_solid_fraction(
+                    scratch.old_temperature_values,
+                    coefficients.theta_r, coefficients.r,
+                    scratch.old_solid_fraction_values);
+
+                if (alpha_2 != 0.)
+                {
+                    evaluate_solid_fraction(
+                        scratch.old_old_temperature_values,
+                        coefficients.theta_r, coefficients.r,
+                        scratch.old_old_solid_fraction_values);
+                }
+            }
+
+            local_matrix = 0.;
+
+            local_rhs = 0.;
+
+            source_function.vector_value_list(
+                fe_values.get_quadrature_points(),
+                scratch.source_values);
+
+            for (unsigned int quad = 0; quad< n_quad_points; ++quad)
+            {
+                /* Name local variables to match notation in Danaila 2014 */
+                const Tensor<1, dim>  u_n = scratch.old_velocity_values[quad];
+                const double theta_n = scratch.old_temperature_values[quad];
+
+                const Tensor<1, dim> u_nminus1 = scratch.old_old_velocity_values[quad];
+                const double theta_nminus1 = scratch.old_old_temperature_values[quad];
+
+                const Tensor<1, dim> u_k = scratch.old_newton_velocity_values[quad];
+                const double p_k = scratch.old_newton_pressure_values[quad];
+                const double theta_k = scratch.old_newton_temperature_values[quad];
+
+                const Tensor<1, dim> gradtheta_k = scratch.old_newton_temperature_gradients[quad];
+                const Tensor<2, dim> gradu_k = scratch.old_newton_velocity_gradients[quad];
+                const double divu_k = scratch.old_newton_velocity_divergences[quad];
+
+                Tensor<1, dim> s_u;
+
+                for (unsigned int d = 0; d < dim; ++d)
+                {
+                    s_u[d] = scratch.source_values[quad][d];
+                }
+
+                const double s_p = scratch.source_values[quad][dim];
+
+                const double s_theta = scratch.source_values[quad][dim+1];
+
+                /*!
+                    With phase change, the viscosity and the conductivity are interpolated between
+                    the liquid and the solid with the solid fraction $\phi$, and the latent heat
+                    adds $-\partial_t \phi(\theta)/Ste$ to the energy equation.
+                    The conductivities are scaled by the liquid conductivity, so the solid's is K.
+                */
+                double mu_k = mu_l, K_k = K;
+
+                double dmu_dtheta_k = 0., dK_dtheta_k = 0.;
+
+                double latent_heat_k = 0., dlatent_heat_dtheta_k = 0.;
+
+                if (phase_change)
+                {
+                    const double phi_k = scratch.solid_fraction_values[quad];
+
+                    const double dphi_k = scratch.solid_fraction_derivatives[quad];
+
+                    const double phi_n = scratch.old_solid_fraction_values[quad];
+
+                    const double phi_nminus1 = (alpha_2 != 0.) ? scratch.old_old_solid_fraction_values[quad] : 0.;
+
+                    mu_k = mu_l + (mu_s - mu_l)*phi_k;
+
+                    dmu_dtheta_k = (mu_s - mu_l)*dphi_k;
+
+                    K_k = 1. + (K - 1.)*phi_k;
+
+                    dK_dtheta_k = (K - 1.)*dphi_k;
+
+                    latent_heat_k = -(alpha_0*phi_k + alpha_1*phi_n + alpha_2*phi_nminus1)/(Ste*deltat);
+
+                    dlatent_heat_dtheta_k = -alpha_0*dphi_k/(Ste*deltat);
+                }
+
+                evaluate_shape_functions(
+                    fe_values,
+                    velocity_extractor,
+                    pressure_extractor,
+                    temperature_extractor,
+                    quad,
+                    scratch);
+
+                for (const unsigned int i : dofs)
+                {
+                    /* Name local variables to match notation in Danaila 2014 */
+                    const Tensor<1, dim> v = scratch.velocity_fe_values[i];
+                    const double q = scratch.pressure_fe_values[i];
+                    const double phi = scratch.temperature_fe_values[i];
+                    const Tensor<1, dim> gradphi = scratch.grad_temperature_fe_values[i];
+                    const Tensor<2, dim> gradv = scratch.grad_velocity_fe_values[i];
+                    const double divv = scratch.div_velocity_fe_values[i];
+
+                    /* @todo Here I implemented the form derived in danaila2014newton, where they
+                    multiplied by test functions from the right. deal.II's tutorials recommend to get
+                    in the habit of instead multiplying from the left, to avoid a common class of errors.
+                    If verification fails, then I should try deriving my own form, with the left multiplication, and see if this helps.
+                    */
+                    for (unsigned int jj = 0; jj < n_matrix_dofs; ++jj)
+                    {
+                        const unsigned int j = dofs[jj];
+
+                        const Tensor<1, dim> u_w = scratch.velocity_fe_values[j];
+                        const double p_w = scratch.pressure_fe_values[j];
+                        const double theta_w = scratch.temperature_fe_values[j];
+                        const Tensor<1, dim> gradtheta_w = scratch.grad_temperature_fe_values[j];
+                        const Tensor<2, dim> gradu_w = scratch.grad_velocity_fe_values[j];
+                        const double divu_w = scratch.div_velocity_fe_values[j];
+
+                        if (!coefficients.linear_terms) /* They were assembled separately by assemble_linear_cell. */
+                        {
+                            local_matrix(i,j) += (
+                                newton_terms*c(u_w, gradu_k, v) + c(u_k, gradu_w, v) // Momentum: Convection
+                                - scalar_product(u_k, gradphi)*theta_w - newton_terms*scalar_product(u_w, gradphi)*theta_k // Energy: Advection
+                                )*fe_values.JxW(quad);
+
+                            if (phase_change)
+                            {
+                                local_matrix(i,j) += (
+                                    a(mu_k, gradu_w, gradv) // Momentum: Viscous stress
+                                    + scalar_product(K_k/Pr*gradtheta_w, gradphi) // Energy: Diffusion
+                                    )*fe_values.JxW(quad);
+                            }
+                        }
+                        else
+                        {
+                            local_matrix(i,j) += (
+                                b(divu_w, q) - gamma*p_w*q // Mass
+                                + alpha_0*scalar_product(u_w, v)/deltat + newton_terms*c(u_w, gradu_k, v) + c(u_k, gradu_w, v) + a(mu_k, gradu_w, gradv) + b(divv, p_w) // Momentum: Incompressible Navier-Stokes
+                                + scalar_product(theta_w*df_B_over_dtheta, v) // Momentum: Bouyancy (Classical linear Boussinesq approximation)
+                                + alpha_0*theta_w*phi/deltat - scalar_product(u_k, gradphi)*theta_w - newton_terms*scalar_product(u_w, gradphi)*theta_k + scalar_product(K_k/Pr*gradtheta_w, gradphi) // Energy
+                                )*fe_values.JxW(quad); /* Map to the reference element */
+                        }
+
+                        if (phase_change)
+                        {
+                            local_matrix(i,j) += (
+                                newton_terms*a(dmu_dtheta_k*theta_w, gradu_k, gradv) // Momentum: Phase-dependent viscosity
+                                + dlatent_heat_dtheta_k*theta_w*phi + newton_terms*scalar_product(dK_dtheta_k*theta_w/Pr*gradtheta_k, gradphi) // Energy: Latent heat and phase-dependent conductivity
+                                )*fe_values.JxW(quad);
+                        }
+
+                    }
+
+                    local_rhs(i) += (
+                            b(divu_k, q) - gamma*p_k*q // Mass
+                            + scalar_product(alpha_0*u_k + alpha_1*u_n + alpha_2*u_nminus1, v)/deltat + c(u_k, gradu_k, v) + a(mu_k, gradu_k, gradv) + b(divv, p_k) // Momentum: Incompressible Navier-Stokes
+                            + scalar_product(f_B(theta_k), v) // Momentum: Bouyancy (Classical linear Boussinesq approximation)
+                            + (alpha_0*theta_k + alpha_1*theta_n + alpha_2*theta_nminus1)*phi/deltat - scalar_product(u_k, gradphi)*theta_k + scalar_product(K_k/Pr*gradtheta_k, gradphi) // Energy
+                            + s_p*q + scalar_product(s_u, v) + s_theta*phi // Source (MMS)
+                            )*fe_values.JxW(quad);
+
+                    if (phase_change)
+                    {
+                        local_rhs(i) += latent_heat_k*phi*fe_values.JxW(quad); // Energy: Latent heat
+                    }
+
+                }
+
+            }
+
+        }
+
+    }
+
+}
+
+#endif
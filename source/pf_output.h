@@ -4,11 +4,20 @@
 template<int dim>
 void Phaseflow<dim>::write_solution()
 {
+    TimerOutput::Scope timer_section(this->timer, "output");
+    
   
     if (this->params.output.write_solution_vtk)
     {
+        std::string file_name = "solution-";
+        
+        if (this->continuation_stage > 0)
+        {
+            file_name += Utilities::int_to_string(this->continuation_stage) + "-";
+        }
+        
         Output::write_solution_to_vtk(
-            "solution-"+Utilities::int_to_string(this->time_step_counter)+".vtk",
+            this->output_path(file_name+Utilities::int_to_string(this->time_step_counter)+".vtk"),
             this->dof_handler,
             this->solution);    
     }
@@ -47,12 +47,33 @@ namespace Phaseflow
         struct Meta
         {
             unsigned int dim;
+            bool distributed;
         };
 
+        struct PhaseChange
+        {
+            bool enabled;
+            double stefan_number;
+            double solid_dynamic_viscosity;
+            double central_temperature;
+            double smoothing_parameter;
+        };
+        
         struct PhysicalModel
         {
             std::vector<double> gravity;
             double liquid_dynamic_viscosity;
+            double rayleigh_number;
+            double prandtl_number;
+            double solid_conductivity;
+            double liquid_conductivity;
+            PhaseChange phase_change;
+        };
+        
+        struct Continuation
+        {
+            std::string parameter;
+            std::vector<double> values;
         };
         
         struct Geometry
@@ -88,6 +109,19 @@ namespace Phaseflow
             AdaptiveRefinement adaptive;
         };
         
+        struct Renumbering
+        {
+            std::vector<std::string> methods;
+            std::vector<double> downstream_direction;
+            bool report_statistics;
+        };
+        
+        struct GridCache
+        {
+            bool enabled;
+            std::string directory;
+        };
+        
         struct Time
         {
             double end;
@@ -97,18 +131,98 @@ namespace Phaseflow
             unsigned int max_steps;
             bool stop_when_steady;
             double steady_tolerance;
+            std::string integrator;
+            double error_tolerance;
+            double step_safety_factor;
+            double growth_rate;
+            double epsilon;
         };
 
-        struct IterativeSolver
+        struct PseudoTransient
+        {
+            bool enabled;
+            double initial_step_size;
+            double max_step_size;
+            unsigned int max_iterations;
+            double tolerance;
+        };
+        
+        struct Picard
+        {
+            unsigned int anderson_depth;
+            double newton_switch_tolerance;
+        };
+        
+        struct NonlinearSolver
         {
             std::string method;
+            std::string coupling;
             unsigned int max_iterations;
             double tolerance;
+            Picard picard;
+        };
+        
+        struct InexactNewton
+        {
+            bool enabled;
+            double initial_forcing_term;
+            double max_forcing_term;
+            double gamma;
+            double alpha;
+        };
+        
+        struct MultigridPreconditioner
+        {
+            unsigned int smoothing_steps;
+        };
+        
+        struct MixedPrecision
+        {
+            double inner_tolerance;
+            unsigned int max_refinement_steps;
+        };
+        
+        struct LinearSolver
+        {
+            std::string method;
+            std::string preconditioner;
+            unsigned int max_iterations;
+            double tolerance;
+            unsigned int gmres_restart;
+            InexactNewton inexact_newton;
+            MultigridPreconditioner multigrid;
+            MixedPrecision mixed_precision;
+        };
+        
+        struct Assembly
+        {
+            bool precompute_linear_terms;
+            bool incremental_jacobian;
+            double reassembly_tolerance;
+            bool cache_cell_values;
+            double cell_values_cache_max_memory;
+            double local_matrices_cache_max_memory;
         };
         
         struct Output
         {
             bool write_solution_vtk;
+            bool write_linear_system;
+            bool write_newton_iterates;
+            std::string directory;
+        };
+        
+        struct Profiling
+        {
+            bool enabled;
+            std::string report_file;
+            bool memory_report;
+        };
+        
+        struct Telemetry
+        {
+            bool enabled;
+            std::string file_name;
         };
         
         struct Verification
@@ -123,27 +237,87 @@ namespace Phaseflow
             BoundaryConditions boundary_conditions;
             Geometry geometry;
             Refinement refinement;
+            Renumbering renumbering;
+            GridCache grid_cache;
             Time time;
-            IterativeSolver nonlinear_solver;
+            PseudoTransient pseudo_transient;
+            NonlinearSolver nonlinear_solver;
+            LinearSolver linear_solver;
+            Assembly assembly;
             Output output;
+            Profiling profiling;
+            Telemetry telemetry;
             Verification verification;
+            Continuation continuation;
         };    
 
-        template<int dim>
-        void declare(ParameterHandler &prm)
+        /*! Get the path of an output file in the output directory */
+        std::string output_path(const Output &output, const std::string &file_name)
+        {
+            return output.directory.empty() ? file_name : output.directory + "/" + file_name;
+        }
+        
+        void declare_meta(ParameterHandler &prm, const unsigned int default_dim)
         {
-            
             prm.enter_subsection("meta");
             {
-                prm.declare_entry("dim", std::to_string(dim), Patterns::Integer(1, 3));
+                prm.declare_entry("dim", std::to_string(default_dim), Patterns::Integer(1, 3));
+                
+                prm.declare_entry("distributed", "false", Patterns::Bool(),
+                    "Run the MPI distributed model. This is implied when running with more than one MPI process.");
             }
             prm.leave_subsection();
+        }
+        
+        template<int dim>
+        void declare(ParameterHandler &prm)
+        {
+            
+            declare_meta(prm, dim);
 
             
             prm.enter_subsection("physics");
             {
                 prm.declare_entry("gravity", "0., -1, 0.", Patterns::List(Patterns::Double()));
                 prm.declare_entry("liquid_dynamic_viscosity", "1.", Patterns::Double(0.));
+                prm.declare_entry("rayleigh_number", "1.e6", Patterns::Double(0.));
+                prm.declare_entry("prandtl_number", "0.71", Patterns::Double(0.));
+                prm.declare_entry("solid_conductivity", "1.", Patterns::Double(0.));
+                prm.declare_entry("liquid_conductivity", "2.", Patterns::Double(0.),
+                    "The conductivities are only used as the ratio solid_conductivity/liquid_conductivity.");
+                
+                prm.enter_subsection("phase_change");
+                {
+                    prm.declare_entry("enabled", "false", Patterns::Bool(),
+                        "Add the latent heat, and the phase-dependent viscosity and conductivity,"
+                        " with the solid fraction regularized as a function of temperature.");
+                        
+                    prm.declare_entry("stefan_number", "1.", Patterns::Double(0.));
+                    
+                    prm.declare_entry("solid_dynamic_viscosity", "1.e8", Patterns::Double(0.),
+                        "This penalizes the velocity in the solid.");
+                        
+                    prm.declare_entry("central_temperature", "0.", Patterns::Double(),
+                        "Temperature at which the regularized solid fraction is one half.");
+                        
+                    prm.declare_entry("smoothing_parameter", "0.025", Patterns::Double(0.),
+                        "Width of the temperature range over which the regularized solid fraction changes.");
+                }
+                prm.leave_subsection();
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("continuation");
+            {
+                prm.declare_entry("parameter", "none",
+                    Patterns::Selection("none | rayleigh_number | liquid_dynamic_viscosity"),
+                    "Step this physics parameter through the continuation values,"
+                    " warm starting each solve from the previous solution on the same grid.");
+                    
+                prm.declare_entry("values", "",
+                    Patterns::List(Patterns::Double()),
+                    "Schedule of values for the continuation parameter, e.g. increasing Rayleigh numbers.");
             }
             prm.leave_subsection();
             
@@ -223,6 +397,38 @@ namespace Phaseflow
             prm.leave_subsection();
             
             
+            prm.enter_subsection("renumbering");
+            {
+                prm.declare_entry("methods", "",
+                    Patterns::List(Patterns::Selection("Cuthill_McKee | reverse_Cuthill_McKee | hierarchical | downstream")),
+                    "Renumber the degrees of freedom with these methods, in this order."
+                    " The degrees of freedom are always sorted by component afterward,"
+                    " which keeps the order from these methods within each component.");
+                    
+                prm.declare_entry("downstream_direction", "0., -1., 0.",
+                    Patterns::List(Patterns::Double()),
+                    "Flow direction for the downstream method. Only the first dim values are used.");
+                    
+                prm.declare_entry("report_statistics", "false", Patterns::Bool(),
+                    "Print the number of nonzeros, the bandwidth and the profile of the sparsity pattern.");
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("grid_cache");
+            {
+                prm.declare_entry("enabled", "false", Patterns::Bool(),
+                    "Reuse the refined grid, the DoF numbering and the sparsity pattern of earlier runs"
+                    " with the same geometry, refinement and renumbering parameters."
+                    " Within one process, e.g. in batch mode, they are kept in memory.");
+                    
+                prm.declare_entry("directory", "", Patterns::DirectoryName(),
+                    "Also read and write the cache in this existing directory, so that separate processes can share it."
+                    " If empty, then the cache is only kept in memory.");
+            }
+            prm.leave_subsection();
+            
+            
             prm.enter_subsection ("time");
             {
                 prm.declare_entry("end", "0.",
@@ -248,7 +454,53 @@ namespace Phaseflow
                 prm.declare_entry("stop_when_steady", "false", Patterns::Bool());
                 
                 prm.declare_entry("steady_tolerance", "1.e-8", Patterns::Double(0.));
+                
+                prm.declare_entry("integrator", "BackwardEuler",
+                    Patterns::Selection("BackwardEuler | BDF2"),
+                    "BDF2 is second order accurate for variable step sizes. The first step always uses backward Euler.");
+                
+                prm.declare_entry("error_tolerance", "0.",
+                    Patterns::Double(0.),
+                    "Control the step size with this tolerance for the estimated relative local truncation error."
+                    " Otherwise, if zero, the step size simply grows after every converged step.");
+                    
+                prm.declare_entry("step_safety_factor", "0.9",
+                    Patterns::Double(0., 1.),
+                    "Scale the step size proposed by the error control by this factor.");
+                    
+                prm.declare_entry("growth_rate", "2.",
+                    Patterns::Double(1.),
+                    "Grow the step size by this factor after each converged step, and shrink it by this factor after each failed step."
+                    " This also limits the change of the step size by the error control.");
                     
+                prm.declare_entry("epsilon", "1.e-14",
+                    Patterns::Double(0.),
+                    "Tolerance for comparing times and step sizes.");
+                    
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("pseudo_transient");
+            {
+                prm.declare_entry("enabled", "false", Patterns::Bool(),
+                    "Directly solve for the steady state with pseudo-transient continuation,"
+                    " instead of stepping through time.");
+                    
+                prm.declare_entry("initial_step_size", "1.e-2",
+                    Patterns::Double(0.),
+                    "Pseudo time step size for the first iteration."
+                    " Later step sizes grow with the reduction of the steady residual.");
+                    
+                prm.declare_entry("max_step_size", "1.e16",
+                    Patterns::Double(0.));
+                    
+                prm.declare_entry("max_iterations", "200",
+                    Patterns::Integer(0));
+                    
+                prm.declare_entry("tolerance", "1.e-9",
+                    Patterns::Double(0.),
+                    "Stop once the L2 norm of the relative update is below this tolerance.");
             }
             prm.leave_subsection();
             
@@ -256,14 +508,129 @@ namespace Phaseflow
             prm.enter_subsection("nonlinear_solver");
             {
                 prm.declare_entry("method", "Newton",
-                     Patterns::Selection("Newton"));
+                     Patterns::Selection("Newton | Picard"),
+                     "Picard iterations linearize with the convective velocity frozen at the previous iterate,"
+                     " i.e. they solve the Oseen problem, and then switch to Newton iterations.");
+                
+                prm.declare_entry("coupling", "monolithic",
+                     Patterns::Selection("monolithic | segregated"),
+                     "Segregated iterations alternate between solving the flow (velocity and pressure)"
+                     " with the temperature frozen, and solving the energy equation with the flow frozen,"
+                     " until the coupled problem converges.");
                      
                 prm.declare_entry("max_iterations", "50",
                     Patterns::Integer(0));
                     
                 prm.declare_entry("tolerance", "1e-9",
                     Patterns::Double(0.));
+                
+                prm.enter_subsection("picard");
+                {
+                    prm.declare_entry("anderson_depth", "5",
+                        Patterns::Integer(0),
+                        "Accelerate the Picard iterations with Anderson mixing over this many previous iterates."
+                        " Set to zero to disable the acceleration.");
+                        
+                    prm.declare_entry("newton_switch_tolerance", "1e-2",
+                        Patterns::Double(0.),
+                        "Switch to Newton iterations once the relative residual is below this tolerance.");
+                }
+                prm.leave_subsection();
+                    
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("linear_solver");
+            {
+                prm.declare_entry("method", "direct",
+                     Patterns::Selection("direct | GMRES | mixed_precision"),
+                     "Solve each Newton linearized system with UMFPACK, or iteratively with preconditioned GMRES,"
+                     " or with iterative refinement of single precision ILU preconditioned GMRES solves.");
+                     
+                prm.declare_entry("max_iterations", "1000",
+                    Patterns::Integer(0));
+                    
+                prm.declare_entry("tolerance", "1e-12",
+                    Patterns::Double(0.),
+                    "Tolerance of the iterative solver relative to the norm of the right hand side.");
+                    
+                prm.declare_entry("gmres_restart", "100",
+                    Patterns::Integer(1));
+                
+                prm.declare_entry("preconditioner", "ILU",
+                    Patterns::Selection("ILU | block_multigrid"),
+                    "Precondition GMRES with ILU of the whole system, or block diagonally,"
+                    " with geometric multigrid for the velocity and temperature blocks."
+                    " The multigrid operators neglect advection, so block_multigrid is only suitable"
+                    " when the time derivative and diffusion dominate, e.g. small time steps or small Rayleigh numbers.");
+                
+                prm.enter_subsection("inexact_newton");
+                {
+                    prm.declare_entry("enabled", "false", Patterns::Bool(),
+                        "Relax the iterative solver tolerance with the Eisenstat-Walker forcing terms.");
                     
+                    prm.declare_entry("initial_forcing_term", "0.5",
+                        Patterns::Double(0., 1.),
+                        "Relative tolerance for the first linear solve of each nonlinear problem.");
+                        
+                    prm.declare_entry("max_forcing_term", "0.9",
+                        Patterns::Double(0., 1.));
+                        
+                    prm.declare_entry("gamma", "0.9",
+                        Patterns::Double(0., 1.));
+                        
+                    prm.declare_entry("alpha", "1.618",
+                        Patterns::Double(1., 2.));
+                }
+                prm.leave_subsection();
+                
+                prm.enter_subsection("multigrid");
+                {
+                    prm.declare_entry("smoothing_steps", "2",
+                        Patterns::Integer(1),
+                        "Number of SOR pre- and post-smoothing steps on each level.");
+                }
+                prm.leave_subsection();
+                
+                prm.enter_subsection("mixed_precision");
+                {
+                    prm.declare_entry("inner_tolerance", "1e-4",
+                        Patterns::Double(0.),
+                        "Relative tolerance of each single precision solve. This should not be much smaller than the single precision round-off.");
+                        
+                    prm.declare_entry("max_refinement_steps", "20",
+                        Patterns::Integer(1));
+                }
+                prm.leave_subsection();
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("assembly");
+            {
+                prm.declare_entry("precompute_linear_terms", "false", Patterns::Bool(),
+                    "Assemble the parts of the Jacobian which do not depend on the Newton iterate only once per grid,"
+                    " and only reassemble the convective terms in each Newton iteration.");
+                    
+                prm.declare_entry("incremental_jacobian", "false", Patterns::Bool(),
+                    "Cache the local matrix of each cell, and only reassemble it where the local values of the iterate changed"
+                    " by more than the reassembly tolerance. The right hand side is always fully assembled.");
+                    
+                prm.declare_entry("reassembly_tolerance", "1e-3", Patterns::Double(0.),
+                    "Reuse a cached local matrix while the maximum change of the cell's local iterate values"
+                    " is at most this times the maximum norm of the iterate. Zero only reuses exact local matrices.");
+                    
+                prm.declare_entry("cache_cell_values", "false", Patterns::Bool(),
+                    "Store the mapped shape function gradients, JxW values and quadrature points of every cell"
+                    " after setting up the system, instead of recomputing them on each cell for each assembly.");
+                    
+                prm.declare_entry("cell_values_cache_max_memory", "1024", Patterns::Double(0.),
+                    "Maximum memory of the cell values cache in MB. For larger grids, the values are computed on the fly.");
+                    
+                prm.declare_entry("local_matrices_cache_max_memory", "1024", Patterns::Double(0.),
+                    "Maximum memory in MB of the local matrices which the incremental Jacobian caches for every cell."
+                    " For larger grids, the Jacobian is fully reassembled.");
             }
             prm.leave_subsection();
             
@@ -271,6 +638,40 @@ namespace Phaseflow
             prm.enter_subsection("output");
             {
                 prm.declare_entry("write_solution_vtk", "true", Patterns::Bool());
+                
+                prm.declare_entry("write_linear_system", "true", Patterns::Bool(),
+                    "Write the matrix and right hand side of each linear system to A.txt and b.txt.");
+                    
+                prm.declare_entry("write_newton_iterates", "false", Patterns::Bool(),
+                    "Write the Newton correction and the iterate of each nonlinear iteration to newton_residual.vtk"
+                    " and newton_solution.vtk, and a diverged iterate to diverged_newton_solution.vtk, for debugging.");
+                    
+                prm.declare_entry("directory", "", Patterns::DirectoryName(),
+                    "Write all output files to this existing directory. If empty, then write them to the working directory.");
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("profiling");
+            {
+                prm.declare_entry("enabled", "false", Patterns::Bool(),
+                    "Print a summary of the wall time spent in each phase at exit, and write a performance report.");
+                    
+                prm.declare_entry("report_file", "performance_report.json", Patterns::FileName(),
+                    "JSON report of the phase timings, and of the nonlinear iterations and rejections of each time step.");
+                    
+                prm.declare_entry("memory_report", "false", Patterns::Bool(),
+                    "Print the memory consumption of the grid, the DoFs, the linear system and the vectors after setting up the system.");
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("telemetry");
+            {
+                prm.declare_entry("enabled", "false", Patterns::Bool(),
+                    "Stream one JSON record of the startup, and one per nonlinear iteration and per time step, to the telemetry file.");
+                    
+                prm.declare_entry("file_name", "telemetry.jsonl", Patterns::FileName());
             }
             prm.leave_subsection();
             
@@ -290,29 +691,48 @@ namespace Phaseflow
         }   
 
         
+        /*!
+        @brief Read only the meta parameters, which select the model to instantiate.
+        
+        @detail
+        
+            Only the meta subsection is declared, and all other entries are skipped,
+            so that the full set of parameters, which depends on the dimension, is only declared and parsed once.
+        */
         Meta read_meta_parameters(const std::string parameter_file="")
         {
             Meta mp;
             
             ParameterHandler prm;
-            declare<2>(prm);
+            declare_meta(prm, 2);
             
             if (parameter_file != "")
             {
-                prm.parse_input(parameter_file);    
+                prm.parse_input(parameter_file, "", /*skip_undefined = */ true);
             }
             
             prm.enter_subsection("meta");
             {
                 mp.dim = prm.get_integer("dim");  
+                mp.distributed = prm.get_bool("distributed");
             }
             prm.leave_subsection();
 
             return mp;
         }
         
+        /*! Print a log file of all the ParameterHandler parameters */
+        void write_parameter_log(ParameterHandler &prm, const Output &output)
+        {
+            std::ofstream parameter_log_file(output_path(output, "used_parameters.prm"));
+            AssertThrow(parameter_log_file.good(), ExcIO());
+            prm.print_parameters(parameter_log_file, ParameterHandler::Text);
+        }
+        
+        /*! Declare the parameters in the empty handler, parse the file, and get the structured parameters, without writing the log */
         template <int dim>
         StructuredParameters read(
+                ParameterHandler &prm,
                 const std::string parameter_file,
                 Functions::ParsedFunction<dim> &source_function,
                 Functions::ParsedFunction<dim> &initial_values_function,
@@ -322,7 +742,6 @@ namespace Phaseflow
 
             StructuredParameters params;
             
-            ParameterHandler prm;
             Parameters::declare<dim>(prm);
 
             if (parameter_file != "")
@@ -330,15 +749,35 @@ namespace Phaseflow
                 prm.parse_input(parameter_file);
             }
             
-            // Print a log file of all the ParameterHandler parameters
-            std::ofstream parameter_log_file("used_parameters.prm");
-            assert(parameter_log_file.good());
-            prm.print_parameters(parameter_log_file, ParameterHandler::Text);
-            
             prm.enter_subsection("physics");
             {
                 params.physics.gravity = MyParameterHandler::get_vector<double>(prm, "gravity");
                 params.physics.liquid_dynamic_viscosity = prm.get_double("liquid_dynamic_viscosity");
+                params.physics.rayleigh_number = prm.get_double("rayleigh_number");
+                params.physics.prandtl_number = prm.get_double("prandtl_number");
+                params.physics.solid_conductivity = prm.get_double("solid_conductivity");
+                params.physics.liquid_conductivity = prm.get_double("liquid_conductivity");
+                
+                prm.enter_subsection("phase_change");
+                {
+                    params.physics.phase_change.enabled = prm.get_bool("enabled");
+                    params.physics.phase_change.stefan_number = prm.get_double("stefan_number");
+                    params.physics.phase_change.solid_dynamic_viscosity = prm.get_double("solid_dynamic_viscosity");
+                    params.physics.phase_change.central_temperature = prm.get_double("central_temperature");
+                    params.physics.phase_change.smoothing_parameter = prm.get_double("smoothing_parameter");
+                }
+                prm.leave_subsection();
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("continuation");
+            {
+                params.continuation.parameter = prm.get("parameter");
+                params.continuation.values = MyParameterHandler::get_vector<double>(prm, "values");
+                
+                AssertThrow((params.continuation.parameter == "none") || (params.continuation.values.size() > 0),
+                    ExcMessage("Continuation of " + params.continuation.parameter + " requires a list of values."));
             }
             prm.leave_subsection();
             
@@ -390,7 +829,8 @@ namespace Phaseflow
 
                 std::vector<std::string> mask_strings = Utilities::split_string_list(strong_masks_string, ',');
 
-                assert(mask_strings.size() == params.boundary_conditions.strong_boundaries.size());
+                AssertThrow(mask_strings.size() == params.boundary_conditions.strong_boundaries.size(),
+                    ExcMessage("There must be one strong mask for each strong boundary."));
                 
                 for (auto mask_string : mask_strings)
                 {
@@ -399,7 +839,8 @@ namespace Phaseflow
                     /* Validate the entries, since we could not use the Parameter::Selection validation here */
                     for (auto name : mask)
                     {
-                        assert(std::find(FIELD_NAMES.begin(), FIELD_NAMES.end(), name) != FIELD_NAMES.end());
+                        AssertThrow(std::find(FIELD_NAMES.begin(), FIELD_NAMES.end(), name) != FIELD_NAMES.end(),
+                            ExcMessage("Unknown field " + name + " in the strong masks."));
                     }
                     
                     params.boundary_conditions.strong_masks.push_back(mask);
@@ -422,6 +863,24 @@ namespace Phaseflow
             prm.leave_subsection();
             
             
+            prm.enter_subsection("renumbering");
+            {
+                params.renumbering.methods = Utilities::split_string_list(prm.get("methods"));
+                params.renumbering.downstream_direction = 
+                    MyParameterHandler::get_vector<double>(prm, "downstream_direction");
+                params.renumbering.report_statistics = prm.get_bool("report_statistics");
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("grid_cache");
+            {
+                params.grid_cache.enabled = prm.get_bool("enabled");
+                params.grid_cache.directory = prm.get("directory");
+            }
+            prm.leave_subsection();
+            
+            
             prm.enter_subsection("time");
             {
                 params.time.end = prm.get_double("end");
@@ -431,27 +890,144 @@ namespace Phaseflow
                 params.time.max_steps = prm.get_integer("max_steps");
                 params.time.stop_when_steady = prm.get_bool("stop_when_steady");
                 params.time.steady_tolerance = prm.get_double("steady_tolerance");
+                params.time.integrator = prm.get("integrator");
+                params.time.error_tolerance = prm.get_double("error_tolerance");
+                params.time.step_safety_factor = prm.get_double("step_safety_factor");
+                params.time.growth_rate = prm.get_double("growth_rate");
+                params.time.epsilon = prm.get_double("epsilon");
             }    
             prm.leave_subsection();
             
             
+            prm.enter_subsection("pseudo_transient");
+            {
+                params.pseudo_transient.enabled = prm.get_bool("enabled");
+                params.pseudo_transient.initial_step_size = prm.get_double("initial_step_size");
+                params.pseudo_transient.max_step_size = prm.get_double("max_step_size");
+                params.pseudo_transient.max_iterations = prm.get_integer("max_iterations");
+                params.pseudo_transient.tolerance = prm.get_double("tolerance");
+            }
+            prm.leave_subsection();
+            
+            
             prm.enter_subsection("nonlinear_solver");
             {
                 params.nonlinear_solver.method = prm.get("method");
+                params.nonlinear_solver.coupling = prm.get("coupling");
                 params.nonlinear_solver.max_iterations = prm.get_integer("max_iterations");
                 params.nonlinear_solver.tolerance = prm.get_double("tolerance");
+                
+                prm.enter_subsection("picard");
+                {
+                    params.nonlinear_solver.picard.anderson_depth = prm.get_integer("anderson_depth");
+                    params.nonlinear_solver.picard.newton_switch_tolerance = prm.get_double("newton_switch_tolerance");
+                }
+                prm.leave_subsection();
+            }    
+            prm.leave_subsection(); 
+            
+            
+            prm.enter_subsection("linear_solver");
+            {
+                params.linear_solver.method = prm.get("method");
+                params.linear_solver.max_iterations = prm.get_integer("max_iterations");
+                params.linear_solver.tolerance = prm.get_double("tolerance");
+                params.linear_solver.gmres_restart = prm.get_integer("gmres_restart");
+                params.linear_solver.preconditioner = prm.get("preconditioner");
+                
+                prm.enter_subsection("inexact_newton");
+                {
+                    params.linear_solver.inexact_newton.enabled = prm.get_bool("enabled");
+                    params.linear_solver.inexact_newton.initial_forcing_term = prm.get_double("initial_forcing_term");
+                    params.linear_solver.inexact_newton.max_forcing_term = prm.get_double("max_forcing_term");
+                    params.linear_solver.inexact_newton.gamma = prm.get_double("gamma");
+                    params.linear_solver.inexact_newton.alpha = prm.get_double("alpha");
+                }
+                prm.leave_subsection();
+                
+                prm.enter_subsection("multigrid");
+                {
+                    params.linear_solver.multigrid.smoothing_steps = prm.get_integer("smoothing_steps");
+                }
+                prm.leave_subsection();
+                
+                prm.enter_subsection("mixed_precision");
+                {
+                    params.linear_solver.mixed_precision.inner_tolerance = prm.get_double("inner_tolerance");
+                    params.linear_solver.mixed_precision.max_refinement_steps = prm.get_integer("max_refinement_steps");
+                }
+                prm.leave_subsection();
             }    
             prm.leave_subsection(); 
             
             
+            prm.enter_subsection("assembly");
+            {
+                params.assembly.precompute_linear_terms = prm.get_bool("precompute_linear_terms");
+                params.assembly.incremental_jacobian = prm.get_bool("incremental_jacobian");
+                params.assembly.reassembly_tolerance = prm.get_double("reassembly_tolerance");
+                params.assembly.cache_cell_values = prm.get_bool("cache_cell_values");
+                params.assembly.cell_values_cache_max_memory = prm.get_double("cell_values_cache_max_memory");
+                params.assembly.local_matrices_cache_max_memory = prm.get_double("local_matrices_cache_max_memory");
+            }
+            prm.leave_subsection();
+            
+            
             prm.enter_subsection("output");
             {
                 params.output.write_solution_vtk = prm.get_bool("write_solution_vtk");
+                params.output.write_linear_system = prm.get_bool("write_linear_system");
+                params.output.write_newton_iterates = prm.get_bool("write_newton_iterates");
+                params.output.directory = prm.get("directory");
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("profiling");
+            {
+                params.profiling.enabled = prm.get_bool("enabled");
+                params.profiling.report_file = prm.get("report_file");
+                params.profiling.memory_report = prm.get_bool("memory_report");
+            }
+            prm.leave_subsection();
+            
+            
+            prm.enter_subsection("telemetry");
+            {
+                params.telemetry.enabled = prm.get_bool("enabled");
+                params.telemetry.file_name = prm.get("file_name");
             }
             prm.leave_subsection();
             
             return params;
         }
+        
+        template <int dim>
+        StructuredParameters read(
+                const std::string parameter_file,
+                Functions::ParsedFunction<dim> &source_function,
+                Functions::ParsedFunction<dim> &initial_values_function,
+                Functions::ParsedFunction<dim> &boundary_function,
+                Functions::ParsedFunction<dim> &exact_solution_function,
+                const bool write_log = true)
+        {
+            ParameterHandler prm;
+            
+            StructuredParameters params = read<dim>(
+                prm,
+                parameter_file,
+                source_function,
+                initial_values_function,
+                boundary_function,
+                exact_solution_function);
+            
+            if (write_log)
+            {
+                write_parameter_log(prm, params.output);
+            }
+            
+            return params;
+        }
 
     }    
 
@@ -0,0 +1,134 @@
+#ifndef _pf_profiling_h_
+#define _pf_profiling_h_
+
+/*!
+@brief Write the phase timings and the time step statistics as JSON.
+
+@detail
+
+    Sections are timed independently, so e.g. the time of "assemble system"
+    is also included in the time of "step newton", which is included in "step time".
+*/
+template<int dim>
+void Phaseflow<dim>::write_performance_report() const
+{
+    const std::map<std::string, double> wall_times = this->timer.get_summary_data(TimerOutput::total_wall_time);
+
+    const std::map<std::string, double> n_calls = this->timer.get_summary_data(TimerOutput::n_calls);
+
+    std::ofstream out_file(this->output_path(this->params.profiling.report_file));
+
+    AssertThrow(out_file.good(), ExcIO());
+
+    out_file << std::setprecision(10);
+
+    out_file << "{" << std::endl
+        << "  \"dim\": " << dim << "," << std::endl
+        << "  \"active_cells\": " << this->triangulation.n_active_cells() << "," << std::endl
+        << "  \"dofs\": " << this->dof_handler.n_dofs() << "," << std::endl
+        << "  \"sections\": {";
+
+    std::string separator = "";
+
+    for (auto section : wall_times)
+    {
+        out_file << separator << std::endl
+            << "    \"" << section.first << "\": {\"calls\": " << n_calls.at(section.first)
+            << ", \"wall_time\": " << section.second << "}";
+
+        separator = ",";
+    }
+
+    out_file << std::endl << "  }," << std::endl
+        << "  \"steps\": [";
+
+    separator = "";
+
+    for (auto step : this->step_statistics)
+    {
+        out_file << separator << std::endl
+            << "    {\"stage\": " << step.stage
+            << ", \"step\": " << step.step
+            << ", \"time\": " << step.time
+            << ", \"step_size\": " << step.step_size
+            << ", \"nonlinear_iterations\": " << step.nonlinear_iterations
+            << ", \"rejections\": " << step.rejections << "}";
+
+        separator = ",";
+    }
+
+    out_file << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+    out_file.close();
+}
+
+/*! Print the memory consumption of the main data structures, in MB */
+template<int dim>
+void Phaseflow<dim>::report_memory_consumption() const
+{
+    const double MB = 1024.*1024.;
+
+    std::size_t vectors = 0;
+
+    for (auto vector : {
+        &this->solution,
+        &this->newton_residual,
+        &this->old_solution,
+        &this->old_old_solution,
+        &this->old_old_old_solution,
+        &this->system_rhs})
+    {
+        vectors += vector->memory_consumption();
+    }
+
+    std::size_t subsystems = 0;
+
+    for (auto &subsystem : this->subsystems)
+    {
+        subsystems += subsystem.sparsity_pattern.memory_consumption() + subsystem.matrix.memory_consumption()
+            + subsystem.rhs.memory_consumption() + subsystem.correction.memory_consumption();
+    }
+
+    TableHandler table;
+
+    const std::vector<std::pair<std::string, std::size_t>> items = {
+        {"triangulation", this->triangulation.memory_consumption()},
+        {"dof_handler", this->dof_handler.memory_consumption()},
+        {"constraints", this->constraints.memory_consumption()},
+        {"sparsity_pattern", this->sparsity_pattern.memory_consumption()},
+        {"system_matrix", this->system_matrix.memory_consumption()},
+        {"single_precision_matrix", this->single_precision_matrix.memory_consumption()},
+        {"linear_terms_matrices", this->mass_matrix.memory_consumption() + this->linear_terms_matrix.memory_consumption()},
+        {"vectors", vectors},
+        {"segregated_subsystems", subsystems},
+        {"cell_values_cache", this->cell_values_cache.memory_consumption()},
+        {"cached_local_matrices", this->local_matrices_cache_memory}};
+
+    std::size_t total = 0;
+
+    for (auto item : items)
+    {
+        table.add_value("object", item.first);
+        table.add_value("MB", item.second/MB);
+
+        total += item.second;
+    }
+
+    table.add_value("object", std::string("total"));
+    table.add_value("MB", total/MB);
+
+    table.set_precision("MB", 3);
+
+    Utilities::System::MemoryStats memory_stats;
+
+    Utilities::System::get_memory_stats(memory_stats);
+
+    this->out << "Memory consumption after setup_system:" << std::endl;
+
+    table.write_text(this->out, TableHandler::org_mode_table);
+
+    this->out << "Resident memory = " << memory_stats.VmRSS/1024. << " MB, peak = " 
+        << memory_stats.VmHWM/1024. << " MB" << std::endl;
+}
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef _pf_segregated_h_
+#define _pf_segregated_h_
+
+/*!
+@brief Setup the flow and energy subsystems of the segregated iterations.
+
+@detail
+
+    The sparsity pattern of each subsystem is its diagonal block of the system's sparsity pattern,
+    so that each sub-step only assembles and factorizes the matrix of its own fields.
+    The coupling blocks are never stored, since the segregated iterations lag the coupling terms.
+*/
+template<int dim>
+void Phaseflow<dim>::setup_segregated_subsystems()
+{
+    AssertThrow(this->constraints.n_constraints() == 0,
+        ExcMessage("The segregated iterations do not support hanging nodes."));
+
+    const types::global_dof_index n_flow_dofs = this->dofs_per_field[0] + this->dofs_per_field[1];
+
+    this->subsystems[0].name = "flow";
+
+    this->subsystems[0].first_dof = 0;
+
+    this->subsystems[0].n_dofs = n_flow_dofs;
+
+    this->subsystems[1].name = "energy";
+
+    this->subsystems[1].first_dof = n_flow_dofs;
+
+    this->subsystems[1].n_dofs = this->dofs_per_field[2];
+
+    for (unsigned int s = 0; s < 2; ++s)
+    {
+        Subsystem &subsystem = this->subsystems[s];
+
+        subsystem.cell_dofs.clear();
+
+        for (unsigned int i = 0; i < this->fe.dofs_per_cell; ++i)
+        {
+            const bool is_energy_dof =
+                (this->fe.system_to_component_index(i).first == this->temperature_extractor.component);
+
+            if (is_energy_dof == (s == 1))
+            {
+                subsystem.cell_dofs.push_back(i);
+            }
+        }
+
+        const types::global_dof_index first = subsystem.first_dof, end = first + subsystem.n_dofs;
+
+        DynamicSparsityPattern dsp(subsystem.n_dofs);
+
+        for (types::global_dof_index row = first; row < end; ++row)
+        {
+            for (auto entry = this->sparsity_pattern.begin(row); entry != this->sparsity_pattern.end(row); ++entry)
+            {
+                if ((entry->column() >= first) && (entry->column() < end))
+                {
+                    dsp.add(row - first, entry->column() - first);
+                }
+            }
+        }
+
+        subsystem.sparsity_pattern.copy_from(dsp);
+
+        subsystem.matrix.reinit(subsystem.sparsity_pattern);
+
+        subsystem.rhs.reinit(subsystem.n_dofs);
+
+        subsystem.correction.reinit(subsystem.n_dofs);
+    }
+}
+
+/*!
+@brief Assemble the diagonal block of the Newton linearized system for one subsystem.
+
+@detail
+
+    The cell kernel only computes the rows and columns of the subsystem's DoFs.
+    The fields of the other subsystem are frozen at the current iterate, i.e. the coupling terms are lagged.
+
+    The precomputed linear terms and the cached local matrices belong to the whole system,
+    so the subsystem's block assembles all of its terms.
+*/
+template<int dim>
+void Phaseflow<dim>::assemble_subsystem(Subsystem &subsystem)
+{
+    TimerOutput::Scope timer_section(this->timer, "assemble " + subsystem.name + " subsystem");
+
+    subsystem.matrix = 0.;
+
+    subsystem.rhs = 0.;
+
+    const LocalAssembly::Coefficients<dim> coefficients = this->get_coefficients();
+
+    QGauss<dim> quadrature_formula(SCALAR_DEGREE + 2);
+
+    FEValues<dim> fe_values(
+        this->fe,
+        quadrature_formula,
+        update_values | update_gradients | update_quadrature_points | update_JxW_values);
+
+    const unsigned int dofs_per_cell = this->fe.dofs_per_cell;
+
+    FullMatrix<double> local_matrix(dofs_per_cell, dofs_per_cell);
+
+    Vector<double> local_rhs(dofs_per_cell);
+
+    std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+
+    LocalAssembly::ScratchData<dim> scratch(quadrature_formula.size(), dofs_per_cell);
+
+    this->source_function.set_time(this->new_time);
+
+    auto assemble_cell = [&](const auto &cell_values)
+    {
+        LocalAssembly::assemble_cell(
+            cell_values,
+            this->velocity_extractor,
+            this->pressure_extractor,
+            this->temperature_extractor,
+            this->old_solution,
+            this->old_old_solution,
+            this->solution,
+            local_dof_indices,
+            this->source_function,
+            coefficients,
+            scratch,
+            local_matrix,
+            local_rhs,
+            /* assemble_matrix = */ true,
+            &subsystem.cell_dofs);
+    };
+
+    for (auto cell : this->dof_handler.active_cell_iterators())
+    {
+        cell->get_dof_indices(local_dof_indices);
+
+        if (this->cell_values_cache.empty())
+        {
+            fe_values.reinit(cell);
+
+            assemble_cell(fe_values);
+        }
+        else
+        {
+            assemble_cell(this->cell_values_cache.cell_values(cell->active_cell_index()));
+        }
+
+        /* There are no hanging node constraints, so the local contributions are added directly. */
+        for (const unsigned int i : subsystem.cell_dofs)
+        {
+            const types::global_dof_index row = local_dof_indices[i] - subsystem.first_dof;
+
+            subsystem.rhs(row) += local_rhs(i);
+
+            for (const unsigned int j : subsystem.cell_dofs)
+            {
+                subsystem.matrix.add(row, local_dof_indices[j] - subsystem.first_dof, local_matrix(i, j));
+            }
+        }
+    }
+}
+
+/*! Apply the strong boundary values of the Newton correction to the subsystem's rows */
+template<int dim>
+void Phaseflow<dim>::apply_boundary_values_to_subsystem(
+    Subsystem &subsystem,
+    const std::map<types::global_dof_index, double> &residual_boundary_values)
+{
+    TimerOutput::Scope timer_section(this->timer, "apply boundary values and constraints");
+
+    std::map<types::global_dof_index, double> subsystem_boundary_values;
+
+    for (auto m : residual_boundary_values)
+    {
+        if ((m.first >= subsystem.first_dof) && (m.first < subsystem.first_dof + subsystem.n_dofs))
+        {
+            subsystem_boundary_values[m.first - subsystem.first_dof] = m.second;
+        }
+    }
+
+    subsystem.correction = 0.;
+
+    MatrixTools::apply_boundary_values(
+        subsystem_boundary_values,
+        subsystem.matrix,
+        subsystem.correction,
+        subsystem.rhs);
+}
+
+/*!
+@brief Solve the subsystem for its Newton correction.
+
+@detail
+
+    The direct method factorizes only the subsystem's matrix.
+    Otherwise, the subsystem is solved with ILU preconditioned GMRES, to the inexact Newton tolerance of the subsystem;
+    the mixed precision solver and the block multigrid preconditioner are only implemented for the whole system.
+*/
+template<int dim>
+void Phaseflow<dim>::solve_subsystem(Subsystem &subsystem)
+{
+    TimerOutput::Scope timer_section(this->timer, "solve " + subsystem.name + " subsystem");
+
+    if (this->params.linear_solver.method == "direct")
+    {
+        SparseDirectUMFPACK A_inv;
+
+        A_inv.initialize(subsystem.matrix);
+
+        A_inv.vmult(subsystem.correction, subsystem.rhs);
+
+        this->linear_iteration_count = 0;
+
+        this->out << "Solved " << subsystem.name << " subsystem" << std::endl;
+
+        return;
+    }
+
+    SolverControl solver_control(
+        this->params.linear_solver.max_iterations,
+        this->linear_solver_tolerance*subsystem.rhs.l2_norm());
+
+    SolverGMRES<> solver(
+        solver_control,
+        SolverGMRES<>::AdditionalData(this->params.linear_solver.gmres_restart));
+
+    SparseILU<double> preconditioner;
+
+    preconditioner.initialize(subsystem.matrix);
+
+    try
+    {
+        solver.solve(subsystem.matrix, subsystem.correction, subsystem.rhs, preconditioner);
+    }
+    catch (SolverControl::NoConvergence &)
+    {
+        if (!this->params.linear_solver.inexact_newton.enabled)
+        {
+            throw;
+        }
+
+        this->out << "GMRES did not reach the forcing term; continuing with the inexact Newton correction." << std::endl;
+    }
+
+    this->linear_iteration_count = solver_control.last_step();
+
+    this->out << "Solved " << subsystem.name << " subsystem with " << solver_control.last_step()
+        << " GMRES iterations, relative tolerance " << this->linear_solver_tolerance << std::endl;
+}
+
+/*!
+@brief Take one segregated (block Gauss-Seidel) iteration and return the norm of the combined correction.
+
+@detail
+
+    First the flow (velocity and pressure) is corrected with the temperature frozen,
+    and then the temperature is corrected with the updated flow frozen.
+    Each sub-step is a Newton step for its own subsystem, with the coupling terms lagged,
+    which only assembles and solves the subsystem's diagonal block.
+
+    For weakly coupled regimes, where the bouyancy is weak, this converges to the solution
+    of the monolithic problem, while each linear solve only has to handle one subsystem.
+
+    The profiling summary reports the wall times of the sub-steps in the sections
+    "assemble flow subsystem", "solve flow subsystem", "assemble energy subsystem" and "solve energy subsystem",
+    which compare to "assemble system" and "solve linear system" of the monolithic iterations.
+*/
+template<int dim>
+double Phaseflow<dim>::step_segregated()
+{
+    TimerOutput::Scope timer_section(this->timer, "step segregated");
+
+    /* These only depend on the time step, so they are the same for both subsystems. */
+    std::map<types::global_dof_index, double> residual_boundary_values;
+
+    this->get_residual_boundary_values(residual_boundary_values);
+
+    const double residual_norm = this->nonlinear_residual_norm;
+
+    this->assembly_wall_time = 0.;
+
+    this->linear_solve_wall_time = 0.;
+
+    unsigned int linear_iterations = 0;
+
+    for (auto &subsystem : this->subsystems)
+    {
+        Timer assembly_timer;
+
+        this->assemble_subsystem(subsystem);
+
+        this->assembly_wall_time += assembly_timer.wall_time();
+
+        this->apply_boundary_values_to_subsystem(subsystem, residual_boundary_values);
+
+        /* Keep separate inexact Newton histories for each subsystem. */
+        this->old_nonlinear_residual_norm = subsystem.residual_norm;
+
+        this->nonlinear_residual_norm = subsystem.rhs.l2_norm();
+
+        subsystem.residual_norm = this->nonlinear_residual_norm;
+
+        this->linear_solver_tolerance = subsystem.linear_solver_tolerance;
+
+        if (this->params.linear_solver.inexact_newton.enabled)
+        {
+            this->update_forcing_term();
+
+            subsystem.linear_solver_tolerance = this->linear_solver_tolerance;
+        }
+
+        Timer linear_solve_timer;
+
+        this->solve_subsystem(subsystem);
+
+        this->linear_solve_wall_time += linear_solve_timer.wall_time();
+
+        linear_iterations += this->linear_iteration_count;
+
+        /* The right hand side of each field is that of its latest subsystem, as the telemetry expects. */
+        for (types::global_dof_index i = 0; i < subsystem.n_dofs; ++i)
+        {
+            this->system_rhs(subsystem.first_dof + i) = subsystem.rhs(i);
+
+            this->newton_residual(subsystem.first_dof + i) = subsystem.correction(i);
+
+            this->solution(subsystem.first_dof + i) -= subsystem.correction(i);
+        }
+    }
+
+    this->linear_iteration_count = linear_iterations;
+
+    /* Restore the history of the whole system, e.g. for pseudo-transient continuation. */
+    this->old_nonlinear_residual_norm = residual_norm;
+
+    this->nonlinear_residual_norm = std::sqrt(
+        std::pow(this->subsystems[0].residual_norm, 2) + std::pow(this->subsystems[1].residual_norm, 2));
+
+    return this->newton_residual.l2_norm();
+}
+
+#endif
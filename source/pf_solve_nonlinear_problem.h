@@ -6,22 +6,89 @@
 template<int dim>
 void Phaseflow<dim>::step_newton()
 {
-    this->old_newton_solution = this->newton_solution;
+    TimerOutput::Scope timer_section(this->timer, "step newton");
+    
+    Timer assembly_timer;
     
     this->assemble_system();
+    
+    this->assembly_wall_time = assembly_timer.wall_time();
+    
+    this->newton_residual = 0.; // Zero initial guess for iterative linear solvers; the boundary values are set next.
 
     this->apply_boundary_values_and_constraints();
+    
+    this->old_nonlinear_residual_norm = this->nonlinear_residual_norm;
+    
+    this->nonlinear_residual_norm = this->system_rhs.l2_norm();
+    
+    if (this->params.linear_solver.inexact_newton.enabled)
+    {
+        this->update_forcing_term();
+    }
 
+    Timer linear_solve_timer;
+    
     this->solve_linear_system();
+    
+    this->linear_solve_wall_time = linear_solve_timer.wall_time();
 
-    this->newton_solution -= this->newton_residual;
+    this->solution -= this->newton_residual;
+}
+
+/*!
+@brief Choose the relative tolerance of the next linear solve from the nonlinear residual history.
+
+@detail
+
+    This is "choice 2" of the forcing terms from Eisenstat and Walker 1996,
+    
+        $\eta_k = \gamma (|| F(w_k) || / || F(w_{k-1}) ||)^\alpha$,
+    
+    including their safeguard against decreasing the forcing term too quickly.
+    
+    Early Newton iterations are far from the solution, so solving their linear systems
+    to full accuracy would be wasted work. As the nonlinear residual decreases,
+    the forcing term tightens, recovering the fast local convergence of Newton's method.
+*/
+template<int dim>
+void Phaseflow<dim>::update_forcing_term()
+{
+    const Parameters::InexactNewton ew = this->params.linear_solver.inexact_newton;
+    
+    if (this->old_nonlinear_residual_norm <= 0.) // There is no residual history during the first iteration.
+    {
+        this->linear_solver_tolerance = ew.initial_forcing_term;
+        
+        return;
+    }
+    
+    double eta = ew.gamma*std::pow(this->nonlinear_residual_norm/this->old_nonlinear_residual_norm, ew.alpha);
+    
+    const double eta_safeguard = ew.gamma*std::pow(this->linear_solver_tolerance, ew.alpha);
+    
+    if (eta_safeguard > 0.1)
+    {
+        eta = std::max(eta, eta_safeguard);
+    }
+    
+    eta = std::min(eta, ew.max_forcing_term);
+    
+    this->linear_solver_tolerance = std::max(eta, this->params.linear_solver.tolerance);
 }
 
-/*! Iterate the Newton method to solve the nonlinear problem */
+/*! Iterate the Newton method to solve the nonlinear problem
+
+The Picard method instead iterates the Oseen linearization, optionally with Anderson acceleration,
+and switches to the Newton method once inside of its convergence basin.
+
+*/
 template<int dim>
 bool Phaseflow<dim>::solve_nonlinear_problem()
 {
-    this->newton_solution = this->solution;
+    this->use_picard_linearization = (this->params.nonlinear_solver.method == "Picard");
+    
+    NonlinearSolvers::AndersonAcceleration anderson(this->params.nonlinear_solver.picard.anderson_depth);
     
     bool converged = false;
 
@@ -29,40 +96,113 @@ bool Phaseflow<dim>::solve_nonlinear_problem()
     
     double old_norm_residual = 1.e32;
     
+    this->nonlinear_residual_norm = 0.;
+    
+    this->linear_solver_tolerance = this->params.linear_solver.tolerance;
+    
+    const bool segregated = (this->params.nonlinear_solver.coupling == "segregated");
+    
+    for (auto &subsystem : this->subsystems)
+    {
+        subsystem.residual_norm = 0.;
+        
+        subsystem.linear_solver_tolerance = this->params.linear_solver.tolerance;
+    }
+    
     for (i = 0; i < this->params.nonlinear_solver.max_iterations; ++i)
     {
-        this->step_newton();
+        double norm_correction;
         
-        Output::write_solution_to_vtk( // @todo Debugging
-            "newton_residual.vtk",
-            this->dof_handler,
-            this->newton_residual);
-
-        Output::write_solution_to_vtk( // @todo Debugging
-            "newton_solution.vtk",
-            this->dof_handler,
-            this->newton_solution);
+        if (segregated)
+        {
+            norm_correction = this->step_segregated();
+        }
+        else
+        {
+            this->step_newton();
+            
+            if (this->use_picard_linearization)
+            {
+                anderson.accelerate_correction(this->newton_residual, this->solution);
+            }
+            
+            norm_correction = this->newton_residual.l2_norm();
+        }
+        
+        if (this->params.output.write_newton_iterates)
+        {
+            Output::write_solution_to_vtk(
+                this->output_path("newton_residual.vtk"),
+                this->dof_handler,
+                this->newton_residual);
+
+            Output::write_solution_to_vtk(
+                this->output_path("newton_solution.vtk"),
+                this->dof_handler,
+                this->solution);
+        }
+        
+        double norm_residual = norm_correction/this->solution.l2_norm();
         
-        double norm_residual = this->newton_residual.l2_norm()/this->newton_solution.l2_norm();
+        if (this->telemetry.is_open())
+        {
+            this->write_iteration_telemetry(i + 1, norm_residual);
+        }
+        
+        if (segregated)
+        {
+            this->out << "Segregated iteration: L2 norm of relative residual, || w_w || / || w_k || = " << norm_residual << std::endl;
+        }
         
-        std::cout << "Newton iteration: L2 norm of relative residual, || w_w || / || w_k || = " << norm_residual << std::endl;
+        if (this->use_picard_linearization)
+        {
+            if (!segregated)
+            {
+                this->out << "Picard iteration: L2 norm of relative residual, || w_w || / || w_k || = " << norm_residual << std::endl;
+            }
+            
+            if ((norm_residual < this->params.nonlinear_solver.picard.newton_switch_tolerance) 
+                & (norm_residual >= this->params.nonlinear_solver.tolerance))
+            {
+                this->out << "Switching from Picard to Newton iterations." << std::endl;
+                
+                this->use_picard_linearization = false;
+                
+                old_norm_residual = 1.e32;
+                
+                continue;
+            }
+        }
+        else if (!segregated)
+        {
+            this->out << "Newton iteration: L2 norm of relative residual, || w_w || / || w_k || = " << norm_residual << std::endl;
+        }
         
-        if (norm_residual > old_norm_residual)
+        /* Accelerated Picard iterations and segregated iterations are not monotone, 
+        so only check the monolithic Newton iterations for divergence. */
+        if (!this->use_picard_linearization & !segregated & (norm_residual > old_norm_residual))
         {
             converged = false;
             
-            std::cout << "Newton iteration diverged." << std::endl;
+            this->out << "Newton iteration diverged." << std::endl;
             
-            Output::write_solution_to_vtk( // @todo Debugging
-                "diverged_newton_solution.vtk",
-                this->dof_handler,
-                this->newton_solution);
+            if (this->params.output.write_newton_iterates)
+            {
+                Output::write_solution_to_vtk(
+                    this->output_path("diverged_newton_solution.vtk"),
+                    this->dof_handler,
+                    this->solution);
+            }
                 
             if (this->time_step_size == this->params.time.min_step_size)
             {
-                assert(converged);
+                AssertThrow(converged, ExcMessage("The Newton iterations diverged at the minimum time step size."));
             }
             
+            this->solution = this->old_solution;
+            
+            this->nonlinear_iteration_count = i + 1;
+            
             return converged;
         }
         
@@ -76,16 +216,19 @@ bool Phaseflow<dim>::solve_nonlinear_problem()
 
     }
 
+    this->nonlinear_iteration_count = converged ? i + 1 : i;
+    
     if ((this->time_step_size > this->params.time.min_step_size) & !converged)
     {
+        this->solution = this->old_solution;
+        
         return converged;
     }
     
-    assert(converged);
+    AssertThrow(converged, ExcMessage("The nonlinear solver did not converge at the minimum time step size."));
 
-    std::cout << "Newton method converged after " << i + 1 << " iterations." << std::endl;
-    
-    this->solution = this->newton_solution;
+    /* The Picard method may have switched to the Newton method, so report the method which converged. */
+    this->out << (this->use_picard_linearization ? "Picard" : "Newton") << " method converged after " << i + 1 << " iterations." << std::endl;
     
     return converged;
 }
@@ -0,0 +1,108 @@
+#ifndef _pf_solve_steady_problem_h_
+#define _pf_solve_steady_problem_h_
+
+/*!
+@brief Solve directly for the steady state with pseudo-transient continuation.
+
+@detail
+
+    Each iteration is a single Newton step of the backward Euler problem,
+    where the old time level is set to the current iterate. The time derivative
+    then vanishes from the residual, which becomes the steady residual,
+    while the mass terms scaled by $1/\tau$ remain in the Jacobian to regularize it
+    away from the steady state.
+
+    The pseudo time step grows with the reduction of the steady residual,
+    following the switched evolution relaxation of Mulder and van Leer 1985,
+
+        $\tau_{k+1} = \tau_k || F(w_{k-1}) || / || F(w_k) ||$,
+
+    so that the iteration approaches Newton's method as the steady state is reached.
+
+    The convergence history is written to a table.
+*/
+template<int dim>
+bool Phaseflow<dim>::solve_steady_problem()
+{
+    const Parameters::PseudoTransient ptc = this->params.pseudo_transient;
+
+    double tau = ptc.initial_step_size;
+
+    this->new_time = this->time;
+
+    this->nonlinear_residual_norm = 0.;
+
+    this->linear_solver_tolerance = this->params.linear_solver.tolerance;
+
+    this->use_picard_linearization = false;
+
+    double initial_residual_norm = 0.;
+
+    bool converged = false;
+
+    unsigned int k;
+
+    for (k = 0; k < ptc.max_iterations; ++k)
+    {
+        this->old_solution = this->solution;
+
+        this->time_step_size = tau;
+
+        this->step_newton();
+
+        if (k == 0)
+        {
+            initial_residual_norm = this->nonlinear_residual_norm;
+        }
+
+        const double relative_residual = this->nonlinear_residual_norm/initial_residual_norm;
+
+        const double relative_update = this->newton_residual.l2_norm()/this->solution.l2_norm();
+
+        this->out << "Pseudo-transient iteration " << k + 1 << ": tau = " << tau
+            << ", || F(w_k) || / || F(w_0) || = " << relative_residual
+            << ", || w_w || / || w_k || = " << relative_update << std::endl;
+
+        this->pseudo_transient_history.add_value("iteration", k + 1);
+        this->pseudo_transient_history.add_value("tau", tau);
+        this->pseudo_transient_history.add_value("relative_residual", relative_residual);
+        this->pseudo_transient_history.add_value("relative_update", relative_update);
+
+        if (relative_update < ptc.tolerance)
+        {
+            converged = true;
+            break;
+        }
+
+        if (this->old_nonlinear_residual_norm > 0.)
+        {
+            tau *= this->old_nonlinear_residual_norm/this->nonlinear_residual_norm;
+
+            tau = std::min(tau, ptc.max_step_size);
+        }
+    }
+
+    for (auto column : {"tau", "relative_residual", "relative_update"})
+    {
+        this->pseudo_transient_history.set_precision(column, 6);
+        this->pseudo_transient_history.set_scientific(column, true);
+    }
+
+    std::ofstream out_file(this->output_path("pseudo_transient_history.txt"));
+    AssertThrow(out_file.good(), ExcIO());
+    this->pseudo_transient_history.write_text(out_file);
+    out_file.close();
+
+    if (converged)
+    {
+        this->out << "Pseudo-transient continuation converged after " << k + 1 << " iterations." << std::endl;
+    }
+    else
+    {
+        this->out << "Pseudo-transient continuation did not converge after " << k << " iterations." << std::endl;
+    }
+
+    return converged;
+}
+
+#endif
@@ -20,9 +20,9 @@ void Phaseflow<dim>::set_time_step_size(const double _new_size)
         new_size = this->params.time.end - this->time;
     }
     
-    if (numbers::NumberTraits<double>::abs(new_size - this->time_step_size) > EPSILON)
+    if (numbers::NumberTraits<double>::abs(new_size - this->time_step_size) > this->params.time.epsilon)
     {
-        std::cout << "Set time step to deltat = " << new_size << std::endl;
+        this->out << "Set time step to deltat = " << new_size << std::endl;
     }
     
     this->time_step_size = new_size;
@@ -30,6 +30,108 @@ void Phaseflow<dim>::set_time_step_size(const double _new_size)
 }
 
 
+/*!
+@brief Get the coefficients of the time derivative approximation; see LocalAssembly::get_time_derivative_coefficients.
+
+@detail
+
+    Backward Euler is used for the first time step, since there is no $w_{n-1}$ yet,
+    and for pseudo-transient continuation.
+*/
+template<int dim>
+void Phaseflow<dim>::get_time_derivative_coefficients(double &alpha_0, double &alpha_1, double &alpha_2) const
+{
+    LocalAssembly::get_time_derivative_coefficients(
+        (this->params.time.integrator == "BDF2") 
+            & (this->old_time_step_size > 0.) 
+            & !this->params.pseudo_transient.enabled,
+        this->time_step_size,
+        this->old_time_step_size,
+        alpha_0, alpha_1, alpha_2);
+}
+
+
+/*!
+@brief Estimate the relative local truncation error of the new time step, and get the order of the estimate in the step size.
+
+@detail
+
+    For backward Euler, the local truncation error is $\Delta t_n^2 w''/2$.
+    Rather than solving the step twice, we approximate $w''$ with divided differences
+    of $w_{n+1}$, $w_n$, and $w_{n-1}$, which gives
+    
+        $e = \omega/(1 + \omega) || (w_{n+1} - w_n) - \omega (w_n - w_{n-1}) || / || w_{n+1} ||$,
+        
+    with $\omega = \Delta t_n/\Delta t_{n-1}$. This estimate is second order.
+    
+    For BDF2, the local truncation error is $C \Delta t_n^3 w'''/6$, with the variable step error constant
+    $C = (1 + \omega)^2/(\omega (1 + 2 \omega))$. The predictor $w^P_{n+1}$ which extrapolates
+    the quadratic through $w_n$, $w_{n-1}$ and $w_{n-2}$ has the error $-D w'''/6$,
+    with $D = \Delta t_n (\Delta t_n + \Delta t_{n-1}) (\Delta t_n + \Delta t_{n-1} + \Delta t_{n-2})$.
+    So, as in Milne's device, the error is estimated from the difference of the step and the predictor as
+    
+        $e = C \Delta t_n^3/(D + C \Delta t_n^3) || w_{n+1} - w^P_{n+1} || / || w_{n+1} ||$,
+        
+    which is third order.
+    Until there are three previous solutions, BDF2 uses the second order estimate, which is conservative.
+    
+    The differences are accumulated in a single pass, without allocating temporary vectors.
+*/
+template<int dim>
+double Phaseflow<dim>::estimate_time_error(unsigned int &order) const
+{
+    AssertThrow(this->old_time_step_size > 0., ExcInternalError());
+    
+    const double k = this->time_step_size;
+    
+    const double omega = k/this->old_time_step_size;
+    
+    double sum_of_squares = 0.;
+    
+    if ((this->params.time.integrator == "BDF2") & (this->old_old_time_step_size > 0.))
+    {
+        order = 3;
+        
+        /* Extrapolate from t_n, t_{n-1} and t_{n-2} to t_{n+1} with Lagrange polynomials, with the times relative to t_{n+1} */
+        const double t_0 = -k, t_1 = t_0 - this->old_time_step_size, t_2 = t_1 - this->old_old_time_step_size;
+        
+        const double l_0 = t_1*t_2/((t_0 - t_1)*(t_0 - t_2));
+        
+        const double l_1 = t_0*t_2/((t_1 - t_0)*(t_1 - t_2));
+        
+        const double l_2 = t_0*t_1/((t_2 - t_0)*(t_2 - t_1));
+        
+        for (types::global_dof_index i = 0; i < this->solution.size(); ++i)
+        {
+            const double difference = this->solution[i] - (l_0*this->old_solution[i]
+                + l_1*this->old_old_solution[i] + l_2*this->old_old_old_solution[i]);
+            
+            sum_of_squares += difference*difference;
+        }
+        
+        const double C = (1. + omega)*(1. + omega)/(omega*(1. + 2.*omega));
+        
+        const double D = -t_0*t_1*t_2;
+        
+        const double Ck3 = C*k*k*k;
+        
+        return Ck3/(D + Ck3)*std::sqrt(sum_of_squares)/this->solution.l2_norm();
+    }
+    
+    order = 2;
+    
+    for (types::global_dof_index i = 0; i < this->solution.size(); ++i)
+    {
+        const double second_difference = (this->solution[i] - this->old_solution[i])
+            - omega*(this->old_solution[i] - this->old_old_solution[i]);
+        
+        sum_of_squares += second_difference*second_difference;
+    }
+    
+    return omega/(1. + omega)*std::sqrt(sum_of_squares)/this->solution.l2_norm();
+}
+
+
 /*! Step the simulation from the current time step to the next time step.
 
 This requires iterating through each Newton substep of the timestep, 
@@ -39,9 +141,32 @@ assembling and solving a linear system for each substep, until convergence.
 template <int dim>
 void Phaseflow<dim>::step_time()
 {   
+    TimerOutput::Scope timer_section(this->timer, "step time");
+    
+    Timer step_timer;
+    
+    const bool error_control = this->params.time.error_tolerance > 0.;
+    
+    const bool bdf2 = (this->params.time.integrator == "BDF2");
+    
+    /* The oldest solution is overwritten, so the history is rotated without copying. */
+    if (bdf2 & error_control)
+    {
+        this->old_old_old_solution.swap(this->old_old_solution);
+    }
+    
+    if (bdf2 | error_control)
+    {
+        this->old_old_solution.swap(this->old_solution);
+    }
+    
     this->old_solution = this->solution;
     
     bool converged;
+    
+    double proposed_step_size = this->time_step_size;
+    
+    unsigned int nonlinear_iterations = 0, rejections = 0;
 
     do 
     {
@@ -49,25 +174,83 @@ void Phaseflow<dim>::step_time()
         
         converged = this->solve_nonlinear_problem();
         
+        nonlinear_iterations += this->nonlinear_iteration_count;
+        
         if (!converged)
         {
-            this->set_time_step_size(this->time_step_size/TIME_GROWTH_RATE);
+            rejections++;
+            
+            this->set_time_step_size(this->time_step_size/this->params.time.growth_rate);
+            
+            continue;
+        }
+        
+        if (error_control & (this->old_time_step_size > 0.))
+        {
+            unsigned int order;
+            
+            const double error = this->estimate_time_error(order);
+            
+            /* The error scales with the step size to the order of the estimate. Limit the change of the step size by the growth rate. */
+            double factor = this->params.time.step_safety_factor*std::pow(
+                this->params.time.error_tolerance/std::max(error, this->params.time.epsilon), 1./order);
+                
+            factor = std::min(std::max(factor, 1./this->params.time.growth_rate), this->params.time.growth_rate);
+            
+            proposed_step_size = factor*this->time_step_size;
+            
+            this->out << "Estimated relative local truncation error = " << error << std::endl;
+            
+            if ((error > this->params.time.error_tolerance) 
+                & (this->time_step_size > this->params.time.min_step_size))
+            {
+                this->out << "Rejected time step." << std::endl;
+                
+                this->solution = this->old_solution;
+                
+                this->set_time_step_size(proposed_step_size);
+                
+                converged = false;
+                
+                rejections++;
+            }
         }
         
     } while (!converged);
 
     this->time = this->new_time;
     
-    std::cout << "Reached time t = " << this->time << std::endl;
+    this->old_old_time_step_size = this->old_time_step_size;
     
-    if (this->time >= (this->params.time.end - EPSILON))
+    this->old_time_step_size = this->time_step_size;
+    
+    this->step_statistics.push_back({
+        this->continuation_stage,
+        this->time_step_counter,
+        this->time,
+        this->time_step_size,
+        nonlinear_iterations,
+        rejections});
+    
+    if (this->telemetry.is_open())
+    {
+        this->write_step_telemetry(nonlinear_iterations, rejections, step_timer.wall_time());
+    }
+    
+    this->out << "Reached time t = " << this->time << std::endl;
+    
+    if (this->time >= (this->params.time.end - this->params.time.epsilon))
     {
         return;
     }
     
-    if (converged)
+    if (error_control)
+    {
+        this->set_time_step_size(proposed_step_size);
+    }
+    else
     {   
-        this->set_time_step_size(TIME_GROWTH_RATE*this->time_step_size);        
+        this->set_time_step_size(this->params.time.growth_rate*this->time_step_size);        
     }
 
 }
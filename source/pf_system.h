@@ -5,12 +5,67 @@
 template<int dim>
 void Phaseflow<dim>::setup_system()
 {
+    TimerOutput::Scope timer_section(this->timer, "setup system");
     
     this->dof_handler.distribute_dofs(this->fe);
 
-    DoFRenumbering::component_wise(this->dof_handler);
+    /* Indices of the DoFs of each active cell, in the order of the active cell iterators */
+    auto get_cell_dof_indices = [this]()
+    {
+        std::vector<types::global_dof_index> indices(this->triangulation.n_active_cells()*this->fe.dofs_per_cell);
+        
+        for (auto cell : this->dof_handler.active_cell_iterators())
+        {
+            std::vector<types::global_dof_index> cell_indices(this->fe.dofs_per_cell);
+            
+            cell->get_dof_indices(cell_indices);
+            
+            std::copy(
+                cell_indices.begin(), cell_indices.end(),
+                indices.begin() + cell->active_cell_index()*this->fe.dofs_per_cell);
+        }
+        
+        return indices;
+    };
+    
+    if (this->cached_setup)
+    {
+        this->dof_handler.renumber_dofs(this->cached_setup->dof_renumbering);
+    }
+    else if (this->recorded_setup)
+    {
+        const std::vector<types::global_dof_index> initial_indices = get_cell_dof_indices();
+        
+        this->renumber_dofs();
+        
+        const std::vector<types::global_dof_index> renumbered_indices = get_cell_dof_indices();
+        
+        this->recorded_setup->dof_renumbering.resize(this->dof_handler.n_dofs());
+        
+        for (std::size_t k = 0; k < initial_indices.size(); ++k)
+        {
+            this->recorded_setup->dof_renumbering[initial_indices[k]] = renumbered_indices[k];
+        }
+    }
+    else
+    {
+        this->renumber_dofs();
+    }
+    
+    {
+        std::vector<types::global_dof_index> dofs_per_component(dim + 2);
+        
+        DoFTools::count_dofs_per_component(this->dof_handler, dofs_per_component);
+        
+        this->dofs_per_field = {0, dofs_per_component[dim], dofs_per_component[dim + 1]};
+        
+        for (unsigned int i = 0; i < dim; ++i)
+        {
+            this->dofs_per_field[0] += dofs_per_component[i];
+        }
+    }
 
-    std::cout << std::endl
+    this->out << std::endl
             << "==========================================="
             << std::endl
             << "Number of active cells: " << this->triangulation.n_active_cells()
@@ -27,15 +82,32 @@ void Phaseflow<dim>::setup_system()
         
     this->constraints.close();
 
-    DynamicSparsityPattern dsp(this->dof_handler.n_dofs());
+    if (this->cached_setup)
+    {
+        this->cached_setup->load_sparsity_pattern(this->sparsity_pattern);
+    }
+    else
+    {
+        DynamicSparsityPattern dsp(this->dof_handler.n_dofs());
 
-    DoFTools::make_sparsity_pattern(
-        this->dof_handler,
-        dsp,
-        this->constraints,
-        /*keep_constrained_dofs = */ true);
+        DoFTools::make_sparsity_pattern(
+            this->dof_handler,
+            dsp,
+            this->constraints,
+            /*keep_constrained_dofs = */ true);
+            
+        this->sparsity_pattern.copy_from(dsp);
         
-    this->sparsity_pattern.copy_from(dsp);
+        if (this->recorded_setup)
+        {
+            this->recorded_setup->save_sparsity_pattern(this->sparsity_pattern);
+        }
+    }
+    
+    if (this->params.renumbering.report_statistics)
+    {
+        this->report_sparsity_statistics();
+    }
 
     this->system_matrix.reinit(this->sparsity_pattern);
 
@@ -43,14 +115,224 @@ void Phaseflow<dim>::setup_system()
 
     this->newton_residual.reinit(this->dof_handler.n_dofs());
     
-    this->newton_solution.reinit(this->dof_handler.n_dofs());
-    
     this->old_solution.reinit(this->dof_handler.n_dofs());
     
-    this->old_newton_solution.reinit(this->dof_handler.n_dofs());
+    const bool bdf2 = (this->params.time.integrator == "BDF2");
+    
+    const bool error_control = (this->params.time.error_tolerance > 0.);
+    
+    this->old_old_solution.reinit((bdf2 | error_control) ? this->dof_handler.n_dofs() : 0);
+    
+    this->old_old_old_solution.reinit((bdf2 & error_control) ? this->dof_handler.n_dofs() : 0);
     
     this->system_rhs.reinit(this->dof_handler.n_dofs());
+    
+    if (this->params.linear_solver.method == "mixed_precision")
+    {
+        this->single_precision_matrix.reinit(this->sparsity_pattern);
+    }
+    
+    if (this->params.assembly.precompute_linear_terms)
+    {
+        this->mass_matrix.reinit(this->sparsity_pattern);
+        
+        this->linear_terms_matrix.reinit(this->sparsity_pattern);
+        
+        this->linear_terms_coefficients.reset();
+    }
+    
+    this->cached_local_matrices_coefficients.reset();
+    
+    std::vector<FullMatrix<double>>().swap(this->cached_local_matrices);
+    
+    std::vector<Vector<double>>().swap(this->cached_local_iterates);
+    
+    this->incremental_jacobian = false;
+    
+    this->local_matrices_cache_memory = 0;
+    
+    if (this->params.assembly.incremental_jacobian)
+    {
+        const std::size_t dofs_per_cell = this->fe.dofs_per_cell;
+        
+        const std::size_t memory = this->triangulation.n_active_cells()*(
+            sizeof(FullMatrix<double>) + sizeof(Vector<double>) + (dofs_per_cell*dofs_per_cell + dofs_per_cell)*sizeof(double));
+        
+        if (memory > this->params.assembly.local_matrices_cache_max_memory*1024*1024)
+        {
+            this->out << "The local matrices cache would exceed "
+                << this->params.assembly.local_matrices_cache_max_memory
+                << " MB, so the Jacobian will be fully reassembled." << std::endl;
+        }
+        else
+        {
+            this->incremental_jacobian = true;
+            
+            this->local_matrices_cache_memory = memory;
+        }
+    }
+    
+    if (this->params.assembly.cache_cell_values)
+    {
+        const std::size_t max_memory = this->params.assembly.cell_values_cache_max_memory*1024*1024;
+        
+        if (!this->cell_values_cache.reinit(this->dof_handler, QGauss<dim>(SCALAR_DEGREE + 2), max_memory))
+        {
+            this->out << "The cell values cache would exceed "
+                << this->params.assembly.cell_values_cache_max_memory
+                << " MB, so the cell values will be computed during assembly." << std::endl;
+        }
+    }
+    
+    if ((this->params.linear_solver.method == "GMRES") & (this->params.linear_solver.preconditioner == "block_multigrid"))
+    {
+        this->setup_block_multigrid_preconditioner();
+    }
+    
+    if (this->params.nonlinear_solver.coupling == "segregated")
+    {
+        this->setup_segregated_subsystems();
+    }
+    
+    if (this->params.profiling.memory_report)
+    {
+        this->report_memory_consumption();
+    }
+
+}
+
+/*!
+ @brief Renumber the degrees of freedom with the parameterized methods, and then by component.
+ 
+ @detail
+ 
+    The ordering affects the fill-in of the direct factorization, the quality of ILU,
+    and the memory locality of assembly and matrix-vector products.
+    Sorting by component last keeps the block structure of the system,
+    with the order of each method within each block.
+*/
+template<int dim>
+void Phaseflow<dim>::renumber_dofs()
+{
+    for (auto method : this->params.renumbering.methods)
+    {
+        if (method == "Cuthill_McKee")
+        {
+            DoFRenumbering::Cuthill_McKee(this->dof_handler);
+        }
+        else if (method == "reverse_Cuthill_McKee")
+        {
+            DoFRenumbering::Cuthill_McKee(this->dof_handler, /*reversed = */ true);
+        }
+        else if (method == "hierarchical")
+        {
+            DoFRenumbering::hierarchical(this->dof_handler);
+        }
+        else if (method == "downstream")
+        {
+            Tensor<1, dim> direction;
+            
+            for (unsigned int i = 0; i < std::min((unsigned int) dim, (unsigned int) this->params.renumbering.downstream_direction.size()); ++i)
+            {
+                direction[i] = this->params.renumbering.downstream_direction[i];
+            }
+            
+            DoFRenumbering::downstream(this->dof_handler, direction);
+        }
+        else
+        {
+            AssertThrow(false, ExcNotImplemented());
+        }
+    }
+    
+    DoFRenumbering::component_wise(this->dof_handler);
+}
+
+/*! Print statistics of the sparsity pattern, which indicate the cost of factorizing it */
+template<int dim>
+void Phaseflow<dim>::report_sparsity_statistics() const
+{
+    /* The profile (or envelope) bounds the fill-in of a factorization without pivoting. */
+    std::size_t profile = 0;
+    
+    for (unsigned int row = 0; row < this->sparsity_pattern.n_rows(); ++row)
+    {
+        std::size_t first_column = row;
+        
+        for (auto entry = this->sparsity_pattern.begin(row); entry != this->sparsity_pattern.end(row); ++entry)
+        {
+            first_column = std::min(first_column, (std::size_t) entry->column());
+        }
+        
+        profile += row - first_column;
+    }
+    
+    this->out << "Sparsity pattern: nonzeros = " << this->sparsity_pattern.n_nonzero_elements()
+        << ", bandwidth = " << this->sparsity_pattern.bandwidth()
+        << ", profile = " << profile << std::endl;
+}
 
+/*!
+ @brief Setup the geometric multigrid hierarchies of the velocity and temperature fields.
+ 
+ @detail
+ 
+    The level operators are zero on the strong boundaries of their field. 
+    Multigrid uses the refinement hierarchy of the grid, which must not have hanging nodes.
+*/
+template<int dim>
+void Phaseflow<dim>::setup_block_multigrid_preconditioner()
+{
+    AssertThrow(this->constraints.n_constraints() == 0,
+        ExcMessage("The block multigrid preconditioner does not support hanging nodes."));
+    
+    /* The level operators have the constant liquid viscosity and conductivity, which do not approximate
+    the blocks with the phase dependent viscosity and conductivity. */
+    AssertThrow(!this->params.physics.phase_change.enabled,
+        ExcMessage("The block multigrid preconditioner does not support phase change."));
+    
+    std::set<types::boundary_id> velocity_boundaries, temperature_boundaries;
+    
+    for (unsigned int ib = 0; ib < this->params.boundary_conditions.strong_boundaries.size(); ++ib)
+    {
+        const auto mask = this->params.boundary_conditions.strong_masks[ib];
+        
+        const types::boundary_id b = this->params.boundary_conditions.strong_boundaries[ib];
+        
+        if (std::find(mask.begin(), mask.end(), "velocity") != mask.end())
+        {
+            velocity_boundaries.insert(b);
+        }
+        
+        if (std::find(mask.begin(), mask.end(), "temperature") != mask.end())
+        {
+            temperature_boundaries.insert(b);
+        }
+    }
+    
+    Functions::ZeroFunction<dim> zero_function(dim + 2);
+    
+    std::map<types::global_dof_index, double> boundary_values;
+    
+    this->interpolate_boundary_values(&zero_function, boundary_values);
+    
+    std::vector<types::global_dof_index> strong_boundary_dofs;
+    
+    for (auto m : boundary_values)
+    {
+        strong_boundary_dofs.push_back(m.first);
+    }
+    
+    this->block_multigrid_preconditioner.reset(new LinearSolvers::BlockMultigridPreconditioner<dim>(
+        FESystem<dim>(FE_Q<dim>(SCALAR_DEGREE + 1), dim),
+        FE_Q<dim>(SCALAR_DEGREE)));
+    
+    this->block_multigrid_preconditioner->setup(
+        this->dof_handler,
+        velocity_boundaries,
+        temperature_boundaries,
+        strong_boundary_dofs,
+        this->params.linear_solver.multigrid.smoothing_steps);
 }
 
 /*!
@@ -59,6 +341,9 @@ void Phaseflow<dim>::setup_system()
  @detail
  
     This implements equation (17) from Danaila et al. 2014.
+    
+    The time derivative is discretized either with backward Euler, as in Danaila 2014,
+    or with the variable step BDF2 method; see get_time_derivative_coefficients.
 
      This is the bouyancy force function from Danaila 2014,
 
@@ -76,6 +361,10 @@ void Phaseflow<dim>::setup_system()
     vector-valued.
 
     This models the bouyancy force as only a function of $\theta$.
+    
+    If physics.phase_change is enabled, then this adds the latent heat of the regularized
+    enthalpy method, and penalizes the velocity in the solid with a phase-dependent viscosity,
+    as in Danaila 2014; see LocalAssembly::evaluate_solid_fraction.
 
     Following the implementation approach in
         
@@ -90,74 +379,27 @@ void Phaseflow<dim>::setup_system()
 template<int dim>
 void Phaseflow<dim>::assemble_system()
 {
+    TimerOutput::Scope timer_section(this->timer, "assemble system");
+    
     this->system_matrix = 0.;
     
     this->system_rhs = 0.;
     
-    /*!
-     Local parameters
-    */
-    const double PENALTY = 1.e-7; // @todo: Expose this to ParameterHandler.
-
-    const double
-        Ra = RAYLEIGH_NUMBER,
-        Pr = PRANDTL_NUMBER,
-        Re = REYNOLDS_NUMBER;
+    LocalAssembly::Coefficients<dim> coefficients = this->get_coefficients();
     
-    const double K = SOLID_CONDUCTIVITY/LIQUID_CONDUCTIVITY;
-
-    Tensor<1, dim> g; // @todo: Make this const.
-    for (unsigned int i = 0; i < dim; ++i)
-    {
-        g[i] = this->params.physics.gravity[i];
-    }
-
-    const double mu_l = this->params.physics.liquid_dynamic_viscosity;
-
-    /*!
-     lambda function for classical (linear) Boussinesq bouyancy
-    */
-    auto f_B = [Ra, Pr, Re, g](const double _theta) 
-    {
-        return _theta*Ra/(Pr*Re*Re)*g;
-    };
-
-    /*!
-     Analytical derivative of classical (linear) Boussinesq bouyancy
-    */
-    const Tensor<1, dim> df_B_over_dtheta(Ra/(Pr*Re*Re)*g);
-
-    /*!
-     lambda functions for linear, bilinear, and trilinear operator
-    */
-    auto a = [](
-        const double _mu,
-        const Tensor<2, dim> _gradu,
-        const Tensor<2, dim> _gradv)
+    const bool precompute_linear_terms = this->params.assembly.precompute_linear_terms;
+    
+    if (precompute_linear_terms)
     {
-        auto D = [](
-            const Tensor<2, dim> _gradw)
+        /* Continuation can change the physical parameters. */
+        if (!this->linear_terms_coefficients
+            || !LocalAssembly::have_same_linear_terms(coefficients, *this->linear_terms_coefficients))
         {
-            return 0.5*(_gradw + transpose(_gradw));
-        };
-
-        return 2.*_mu*scalar_product(D(_gradu), D(_gradv));
-    };
-
-    auto b = [](
-        const double _divu,
-        const double _q)
-    {
-        return -_divu*_q;
-    };
-
-    auto c = [](
-        const Tensor<1, dim> _w,
-        const Tensor<2, dim> _gradz,
-        const Tensor<1, dim> _v)
-    {
-        return (_v*_gradz)*_w;
-    };
+            this->assemble_linear_terms(coefficients);
+        }
+        
+        coefficients.linear_terms = false;
+    }
 
     /*!
      Organize data
@@ -180,184 +422,192 @@ void Phaseflow<dim>::assemble_system()
     
     std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
     
-    std::vector<Tensor<1,dim>> old_velocity_values(n_quad_points);
+    LocalAssembly::ScratchData<dim> scratch(n_quad_points, dofs_per_cell);
     
-    std::vector<double> old_pressure_values(n_quad_points);
-
-    std::vector<double> old_temperature_values(n_quad_points);
-    
-    std::vector<Tensor<1,dim>> old_newton_velocity_values(n_quad_points);
+    this->source_function.set_time(this->new_time);
     
-    std::vector<double> old_newton_pressure_values(n_quad_points);
+    const bool incremental = this->incremental_jacobian;
     
-    std::vector<double> old_newton_temperature_values(n_quad_points);
+    if (incremental && (!this->cached_local_matrices_coefficients
+        || !LocalAssembly::have_same_jacobian(coefficients, *this->cached_local_matrices_coefficients)))
+    {
+        /* Empty local matrices are not valid, so this invalidates the whole cache. */
+        this->cached_local_matrices.assign(this->triangulation.n_active_cells(), FullMatrix<double>());
+        
+        this->cached_local_iterates.assign(this->triangulation.n_active_cells(), Vector<double>());
+        
+        this->cached_local_matrices_coefficients.reset(new LocalAssembly::Coefficients<dim>(coefficients));
+    }
     
-    std::vector<Tensor<2,dim>> old_newton_velocity_gradients(n_quad_points);
+    const double reassembly_threshold = this->params.assembly.reassembly_tolerance*this->solution.linfty_norm();
     
-    std::vector<Tensor<1,dim>> old_newton_temperature_gradients(n_quad_points);
-
-    std::vector<double> old_newton_velocity_divergences(n_quad_points);
+    Vector<double> local_iterate(dofs_per_cell);
     
-    std::vector<Vector<double>> source_values(n_quad_points, Vector<double>(dim + 2));
+    this->reassembled_cell_count = 0;
     
-    this->source_function.set_time(this->new_time);
+    /* The kernel gets the cell values either from the cache, or from FEValues. */
+    auto assemble_cell = [&](const auto &cell_values, const bool assemble_matrix)
+    {
+        LocalAssembly::assemble_cell(
+            cell_values,
+            this->velocity_extractor,
+            this->pressure_extractor,
+            this->temperature_extractor,
+            this->old_solution,
+            this->old_old_solution,
+            this->solution,
+            local_dof_indices,
+            this->source_function,
+            coefficients,
+            scratch,
+            local_matrix,
+            local_rhs,
+            assemble_matrix);
+    };
     
     typename DoFHandler<dim>::active_cell_iterator
         cell = this->dof_handler.begin_active(),
         endc = this->dof_handler.end();
-
-    
-    /*!
-        Set local variables to match notation in Danaila 2014
-    */
-    const double deltat = this->time_step_size;
-    
-    const double gamma = PENALTY;
     
     for (; cell != endc; ++cell) /*! Assemble element-wise */
     {
-        fe_values.reinit(cell);
-
-        fe_values[this->velocity_extractor].get_function_values(
-            this->old_solution,
-            old_velocity_values);
-
-        fe_values[this->pressure_extractor].get_function_values(
-            this->old_solution,
-            old_pressure_values);
-        
-        fe_values[this->temperature_extractor].get_function_values(
-            this->old_solution,
-            old_temperature_values);
-        
-        fe_values[this->velocity_extractor].get_function_values(
-            this->old_newton_solution,
-            old_newton_velocity_values);
-
-        fe_values[this->pressure_extractor].get_function_values(
-            this->old_newton_solution,
-            old_newton_pressure_values);
-
-        fe_values[this->temperature_extractor].get_function_values(
-            this->old_newton_solution,
-            old_newton_temperature_values);
-
-        fe_values[this->temperature_extractor].get_function_gradients(
-            this->old_newton_solution,
-            old_newton_temperature_gradients);
-
-        fe_values[this->velocity_extractor].get_function_gradients(
-            this->old_newton_solution,
-            old_newton_velocity_gradients);
-
-        fe_values[this->velocity_extractor].get_function_divergences(
-            this->old_newton_solution,
-            old_newton_velocity_divergences);
-                    
-        std::vector<Tensor<1, dim>> velocity_fe_values(dofs_per_cell);       
-        std::vector<double> pressure_fe_values(dofs_per_cell);
-        std::vector<double> temperature_fe_values(dofs_per_cell);
-        std::vector<Tensor<1, dim>> grad_temperature_fe_values(dofs_per_cell);
-        std::vector<Tensor<2, dim>> grad_velocity_fe_values(dofs_per_cell);
-        std::vector<double> div_velocity_fe_values(dofs_per_cell);
-        
-        local_matrix = 0.;
-        
-        local_rhs = 0.;
+        cell->get_dof_indices(local_dof_indices);
         
-        this->source_function.vector_value_list(
-            fe_values.get_quadrature_points(),
-            source_values);
+        bool assemble_matrix = true;
         
-        for (unsigned int quad = 0; quad< n_quad_points; ++quad)
+        if (incremental)
         {
-            /* Name local variables to match notation in Danaila 2014 */
-            const Tensor<1, dim>  u_n = old_velocity_values[quad];
-            const double theta_n = old_temperature_values[quad];
-            
-            const Tensor<1, dim> u_k = old_newton_velocity_values[quad];
-            const double p_k = old_newton_pressure_values[quad];
-            const double theta_k = old_newton_temperature_values[quad];
-            
-            const Tensor<1, dim> gradtheta_k = old_newton_temperature_gradients[quad];
-            const Tensor<2, dim> gradu_k = old_newton_velocity_gradients[quad];
-            const double divu_k = old_newton_velocity_divergences[quad];
-            
-            Tensor<1, dim> s_u;
+            cell->get_dof_values(this->solution, local_iterate);
             
-            for (unsigned int d = 0; d < dim; ++d)
-            {
-                s_u[d] = source_values[quad][d];
-            }
-             
-            const double s_p = source_values[quad][dim];
-            
-            const double s_theta = source_values[quad][dim+1];
+            const Vector<double> &cached_iterate = this->cached_local_iterates[cell->active_cell_index()];
             
-            for (unsigned int dof = 0; dof < dofs_per_cell; ++dof)
-            {
-                velocity_fe_values[dof] = fe_values[this->velocity_extractor].value(dof, quad);
-                pressure_fe_values[dof] = fe_values[this->pressure_extractor].value(dof, quad);
-                temperature_fe_values[dof] = fe_values[this->temperature_extractor].value(dof, quad);
-                grad_temperature_fe_values[dof] = fe_values[this->temperature_extractor].gradient(dof, quad);
-                grad_velocity_fe_values[dof] = fe_values[this->velocity_extractor].gradient(dof, quad);
-                div_velocity_fe_values[dof] = fe_values[this->velocity_extractor].divergence(dof, quad);
-            }
-
-            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            if (cached_iterate.size() > 0)
             {
-                /* Name local variables to match notation in Danaila 2014 */
-                const Tensor<1, dim> v = velocity_fe_values[i];
-                const double q = pressure_fe_values[i];
-                const double phi = temperature_fe_values[i];
-                const Tensor<1, dim> gradphi = grad_temperature_fe_values[i];
-                const Tensor<2, dim> gradv = grad_velocity_fe_values[i];
-                const double divv = div_velocity_fe_values[i];
+                double max_change = 0.;
                 
-                /* @todo Here I implemented the form derived in danaila2014newton, where they
-                multiplied by test functions from the right. deal.II's tutorials recommend to get
-                in the habit of instead multiplying from the left, to avoid a common class of errors.
-                If verification fails, then I should try deriving my own form, with the left multiplication, and see if this helps.
-                */
-                for (unsigned int j = 0; j< dofs_per_cell; ++j)
+                for (unsigned int i = 0; i < dofs_per_cell; ++i)
                 {
-                    const Tensor<1, dim> u_w = velocity_fe_values[j];
-                    const double p_w = pressure_fe_values[j];
-                    const double theta_w = temperature_fe_values[j];
-                    const Tensor<1, dim> gradtheta_w = grad_temperature_fe_values[j];
-                    const Tensor<2, dim> gradu_w = grad_velocity_fe_values[j];
-                    const double divu_w = div_velocity_fe_values[j];
-
-                    local_matrix(i,j) += (
-                        b(divu_w, q) - gamma*p_w*q // Mass
-                        + scalar_product(u_w, v)/deltat + c(u_w, gradu_k, v) + c(u_k, gradu_w, v) + a(mu_l, gradu_w, gradv) + b(divv, p_w) // Momentum: Incompressible Navier-Stokes
-                        + scalar_product(theta_w*df_B_over_dtheta, v) // Momentum: Bouyancy (Classical linear Boussinesq approximation)
-                        + theta_w*phi/deltat - scalar_product(u_k, gradphi)*theta_w - scalar_product(u_w, gradphi)*theta_k + scalar_product(K/Pr*gradtheta_w, gradphi) // Energy
-                        )*fe_values.JxW(quad); /* Map to the reference element */                        
-
+                    max_change = std::max(max_change, std::abs(local_iterate[i] - cached_iterate[i]));
                 }
                 
-                local_rhs(i) += (
-                        b(divu_k, q) - gamma*p_k*q // Mass
-                        + scalar_product(u_k - u_n, v)/deltat + c(u_k, gradu_k, v) + a(mu_l, gradu_k, gradv) + b(divv, p_k) // Momentum: Incompressible Navier-Stokes
-                        + scalar_product(f_B(theta_k), v) // Momentum: Bouyancy (Classical linear Boussinesq approximation)
-                        + (theta_k - theta_n)*phi/deltat - scalar_product(u_k, gradphi)*theta_k + scalar_product(K/Pr*gradtheta_k, gradphi) // Energy
-                        + s_p*q + scalar_product(s_u, v) + s_theta*phi // Source (MMS)
-                        )*fe_values.JxW(quad); 
-
-            }            
+                assemble_matrix = max_change > reassembly_threshold;
+            }
+        }
+        
+        if (this->cell_values_cache.empty())
+        {
+            fe_values.reinit(cell);
+            
+            assemble_cell(fe_values, assemble_matrix);
+        }
+        else
+        {
+            assemble_cell(this->cell_values_cache.cell_values(cell->active_cell_index()), assemble_matrix);
+        }
+        
+        if (assemble_matrix)
+        {
+            ++this->reassembled_cell_count;
             
+            if (incremental)
+            {
+                this->cached_local_matrices[cell->active_cell_index()] = local_matrix;
+                
+                this->cached_local_iterates[cell->active_cell_index()] = local_iterate;
+            }
         }
             
         // Export local contributions to the global system
-        cell->get_dof_indices(local_dof_indices);
-        
         this->constraints.distribute_local_to_global(
-            local_matrix, local_rhs, local_dof_indices,
+            assemble_matrix ? local_matrix : this->cached_local_matrices[cell->active_cell_index()],
+            local_rhs, local_dof_indices,
             this->system_matrix, this->system_rhs);
 
     }
+    
+    if (precompute_linear_terms)
+    {
+        this->system_matrix.add(1., this->linear_terms_matrix);
+        
+        this->system_matrix.add(coefficients.alpha_0/coefficients.deltat, this->mass_matrix);
+    }
+
+}
 
+/*! Get the coefficients of the linearized system for the current time step and linearization */
+template<int dim>
+LocalAssembly::Coefficients<dim> Phaseflow<dim>::get_coefficients() const
+{
+    double alpha_0, alpha_1, alpha_2;
+    
+    this->get_time_derivative_coefficients(alpha_0, alpha_1, alpha_2);
+    
+    return LocalAssembly::make_coefficients<dim>(
+        this->params,
+        this->time_step_size,
+        alpha_0, alpha_1, alpha_2,
+        this->use_picard_linearization);
+}
+
+/*!
+ @brief Assemble the terms of the Jacobian which do not depend on the Newton iterate into separate matrices.
+ 
+ @detail
+ 
+    These are the time derivative's mass matrix, and the sum of the viscous, pressure,
+    penalty, bouyancy and diffusion terms. assemble_system adds them to the convective terms,
+    and only calls this again after the grid or the physical parameters changed.
+*/
+template<int dim>
+void Phaseflow<dim>::assemble_linear_terms(const LocalAssembly::Coefficients<dim> &coefficients)
+{
+    TimerOutput::Scope timer_section(this->timer, "assemble linear terms");
+    
+    this->mass_matrix = 0.;
+    
+    this->linear_terms_matrix = 0.;
+    
+    QGauss<dim> quadrature_formula(SCALAR_DEGREE + 2);
+
+    FEValues<dim> fe_values(
+        this->fe,
+        quadrature_formula,
+        update_values | update_gradients | update_JxW_values);
+
+    const unsigned int dofs_per_cell = this->fe.dofs_per_cell;
+    
+    FullMatrix<double> local_mass_matrix(dofs_per_cell, dofs_per_cell);
+    
+    FullMatrix<double> local_linear_matrix(dofs_per_cell, dofs_per_cell);
+    
+    std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+    
+    LocalAssembly::ScratchData<dim> scratch(quadrature_formula.size(), dofs_per_cell);
+    
+    for (auto cell : this->dof_handler.active_cell_iterators())
+    {
+        fe_values.reinit(cell);
+        
+        LocalAssembly::assemble_linear_cell(
+            fe_values,
+            this->velocity_extractor,
+            this->pressure_extractor,
+            this->temperature_extractor,
+            coefficients,
+            scratch,
+            local_mass_matrix,
+            local_linear_matrix);
+        
+        cell->get_dof_indices(local_dof_indices);
+        
+        this->constraints.distribute_local_to_global(
+            local_mass_matrix, local_dof_indices, this->mass_matrix);
+        
+        this->constraints.distribute_local_to_global(
+            local_linear_matrix, local_dof_indices, this->linear_terms_matrix);
+    }
+    
+    this->linear_terms_coefficients.reset(new LocalAssembly::Coefficients<dim>(coefficients));
 }
 
 template<int dim>
@@ -401,7 +651,7 @@ void Phaseflow<dim>::interpolate_boundary_values(
             }
             else
             {
-                assert(false);
+                AssertThrow(false, ExcNotImplemented());
             }
                         
         }
@@ -410,17 +660,17 @@ void Phaseflow<dim>::interpolate_boundary_values(
     
 }
 
-/*! Apply the boundary conditions (strong and natural) and apply constraints (including those for hanging nodes */
+/*! Get the strong boundary values of the Newton correction */
 template<int dim>
-void Phaseflow<dim>::apply_boundary_values_and_constraints()
-{       
+void Phaseflow<dim>::get_residual_boundary_values(std::map<types::global_dof_index, double> &residual_boundary_values)
+{
     /* Since we are applying boundary conditions to the Newton linearized system
     to compute a residual, we want to apply the boundary conditions residual, rather
     than the user supplied boundary conditions.
     
     To do this, we evaluate the BC's both at the new time and the current time,
     and we apply the difference. */
-    std::map<types::global_dof_index, double> residual_boundary_values, boundary_values, new_boundary_values;
+    std::map<types::global_dof_index, double> boundary_values, new_boundary_values;
     
     /* @todo Using a FEFieldFunction to interpolate the solution values seems like a terrible idea, 
     since FEFieldFunction is designed to interpolate within the domain. Is there another method when I really just
@@ -428,7 +678,7 @@ void Phaseflow<dim>::apply_boundary_values_and_constraints()
     
     Another reason this is a terrible approach: I am essentially interpolating all of the finite element functions
     to get velocity, pressure, and temperature values, and then these have to be decomposed onto the finite element functions again with interpolate_boundary_values. There should be an easy way to just use the map<global_dof_index, double> to do this directly. */
-    Functions::FEFieldFunction<dim> solution_field_function(this->dof_handler, this->solution);
+    Functions::FEFieldFunction<dim> solution_field_function(this->dof_handler, this->old_solution);
     
     this->interpolate_boundary_values(&solution_field_function, boundary_values);
     
@@ -442,6 +692,17 @@ void Phaseflow<dim>::apply_boundary_values_and_constraints()
         
         residual_boundary_values[m.first] -= boundary_values[m.first];
     }
+}
+
+/*! Apply the boundary conditions (strong and natural) and apply constraints (including those for hanging nodes */
+template<int dim>
+void Phaseflow<dim>::apply_boundary_values_and_constraints()
+{       
+    TimerOutput::Scope timer_section(this->timer, "apply boundary values and constraints");
+    
+    std::map<types::global_dof_index, double> residual_boundary_values;
+    
+    this->get_residual_boundary_values(residual_boundary_values);
 
     MatrixTools::apply_boundary_values(
         residual_boundary_values,
@@ -459,21 +720,188 @@ void Phaseflow<dim>::apply_boundary_values_and_constraints()
 template<int dim>
 void Phaseflow<dim>::solve_linear_system()
 {
-    if (WRITE_LINEAR_SYSTEM)
+    TimerOutput::Scope timer_section(this->timer, "solve linear system");
+    
+    if (this->params.output.write_linear_system)
+    {
+        Output::write_linear_system(
+            this->system_matrix,
+            this->system_rhs,
+            this->output_path("A.txt"),
+            this->output_path("b.txt"));
+    }
+    
+    if (this->params.linear_solver.method == "direct")
+    {
+        SparseDirectUMFPACK A_inv;
+        
+        A_inv.initialize(this->system_matrix);
+        
+        A_inv.vmult(this->newton_residual, this->system_rhs);
+
+        this->constraints.distribute(this->newton_residual);
+
+        this->linear_iteration_count = 0;
+        
+        this->out << "Solved linear system" << std::endl;
+        
+        return;
+    }
+    
+    if (this->params.linear_solver.method == "mixed_precision")
     {
-        Output::write_linear_system(this->system_matrix, this->system_rhs);
+        this->solve_linear_system_with_mixed_precision();
+        
+        return;
     }
     
-    SparseDirectUMFPACK A_inv;
+    AssertThrow(this->params.linear_solver.method == "GMRES", ExcNotImplemented());
     
-    A_inv.initialize(this->system_matrix);
+    SolverControl solver_control(
+        this->params.linear_solver.max_iterations,
+        this->linear_solver_tolerance*this->system_rhs.l2_norm());
+    
+    SolverGMRES<> solver(
+        solver_control,
+        SolverGMRES<>::AdditionalData(this->params.linear_solver.gmres_restart));
+    
+    SparseILU<double> preconditioner;
+    
+    const bool use_multigrid = this->params.linear_solver.preconditioner == "block_multigrid";
+    
+    if (use_multigrid)
+    {
+        double alpha_0, alpha_1, alpha_2;
+        
+        this->get_time_derivative_coefficients(alpha_0, alpha_1, alpha_2);
+        
+        this->block_multigrid_preconditioner->initialize(
+            this->system_matrix,
+            alpha_0/this->time_step_size,
+            this->params.physics.liquid_dynamic_viscosity,
+            this->params.physics.solid_conductivity/this->params.physics.liquid_conductivity
+                /this->params.physics.prandtl_number);
+    }
+    else
+    {
+        preconditioner.initialize(this->system_matrix);
+    }
+    
+    try
+    {
+        if (use_multigrid)
+        {
+            solver.solve(this->system_matrix, this->newton_residual, this->system_rhs, *this->block_multigrid_preconditioner);
+        }
+        else
+        {
+            solver.solve(this->system_matrix, this->newton_residual, this->system_rhs, preconditioner);
+        }
+    }
+    catch (SolverControl::NoConvergence &)
+    {
+        /* An inexact Newton step only has to reduce the linear residual by the forcing term,
+        so an unconverged Krylov solve is still a usable (if less accurate) Newton correction. */
+        if (!this->params.linear_solver.inexact_newton.enabled)
+        {
+            throw;
+        }
+        
+        this->out << "GMRES did not reach the forcing term; continuing with the inexact Newton correction." << std::endl;
+    }
     
-    A_inv.vmult(this->newton_residual, this->system_rhs);
-
     this->constraints.distribute(this->newton_residual);
+    
+    this->linear_iteration_count = solver_control.last_step();
+    
+    this->out << "Solved linear system with " << solver_control.last_step() 
+        << " GMRES iterations, relative tolerance " << this->linear_solver_tolerance << std::endl;
 
-    std::cout << "Solved linear system" << std::endl;
+}
 
+/*!
+ @brief Solve the linear system in single precision, and recover double precision with iterative refinement.
+ 
+ @detail
+ 
+    The matrix and its ILU factors are stored in single precision, which halves their memory traffic.
+    Each refinement step computes the residual $r = b - A x$ with the double precision matrix,
+    and approximately solves $A d = r$ in single precision with ILU preconditioned GMRES,
+    to the relative inner tolerance. Since $A$ is well represented in single precision,
+    this reduces the error by about the inner tolerance per step, until the
+    double precision residual reaches the linear solver tolerance.
+*/
+template<int dim>
+void Phaseflow<dim>::solve_linear_system_with_mixed_precision()
+{
+    const Parameters::MixedPrecision mixed_precision = this->params.linear_solver.mixed_precision;
+    
+    this->single_precision_matrix.copy_from(this->system_matrix);
+    
+    SparseILU<float> preconditioner;
+    
+    preconditioner.initialize(this->single_precision_matrix);
+    
+    const double tolerance = this->linear_solver_tolerance*this->system_rhs.l2_norm();
+    
+    Vector<double> residual(this->system_rhs.size());
+    
+    Vector<float> single_precision_residual(this->system_rhs.size());
+    
+    Vector<float> single_precision_correction(this->system_rhs.size());
+    
+    this->newton_residual = 0.;
+    
+    residual = this->system_rhs;
+    
+    double residual_norm = residual.l2_norm();
+    
+    unsigned int step, inner_iterations = 0;
+    
+    for (step = 0; (step < mixed_precision.max_refinement_steps) & (residual_norm > tolerance); ++step)
+    {
+        single_precision_residual = residual;
+        
+        single_precision_correction = 0.f;
+        
+        SolverControl solver_control(
+            this->params.linear_solver.max_iterations,
+            mixed_precision.inner_tolerance*single_precision_residual.l2_norm());
+        
+        SolverGMRES<Vector<float>> solver(
+            solver_control,
+            SolverGMRES<Vector<float>>::AdditionalData(this->params.linear_solver.gmres_restart));
+        
+        try
+        {
+            solver.solve(this->single_precision_matrix, single_precision_correction, single_precision_residual, preconditioner);
+        }
+        catch (SolverControl::NoConvergence &)
+        {
+            /* An unconverged inner solve still reduces the error, which is all that refinement needs. */
+        }
+        
+        inner_iterations += solver_control.last_step();
+        
+        for (unsigned int i = 0; i < this->newton_residual.size(); ++i)
+        {
+            this->newton_residual(i) += single_precision_correction(i);
+        }
+        
+        residual_norm = this->system_matrix.residual(residual, this->newton_residual, this->system_rhs);
+    }
+    
+    if ((residual_norm > tolerance) & !this->params.linear_solver.inexact_newton.enabled)
+    {
+        throw SolverControl::NoConvergence(step, residual_norm);
+    }
+    
+    this->constraints.distribute(this->newton_residual);
+    
+    this->linear_iteration_count = inner_iterations;
+    
+    this->out << "Solved linear system with " << step << " refinement steps and " << inner_iterations 
+        << " single precision GMRES iterations, relative tolerance " << this->linear_solver_tolerance << std::endl;
 }
 
 #endif
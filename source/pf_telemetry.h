@@ -0,0 +1,86 @@
+#ifndef _pf_telemetry_h_
+#define _pf_telemetry_h_
+
+/*!
+@brief Write a telemetry record for the latest nonlinear iteration.
+
+@detail
+
+    The residual norms are those of the right hand side of the latest linear system,
+    after applying the boundary conditions, restricted to the DoFs of each field.
+    For segregated iterations, this is the latest subsystem.
+*/
+template<int dim>
+void Phaseflow<dim>::write_iteration_telemetry(const unsigned int iteration, const double relative_correction)
+{
+    double field_residual_norms[3];
+
+    types::global_dof_index first = 0;
+
+    for (unsigned int f = 0; f < 3; ++f)
+    {
+        double sum_of_squares = 0.;
+
+        for (types::global_dof_index i = first; i < first + this->dofs_per_field[f]; ++i)
+        {
+            sum_of_squares += this->system_rhs(i)*this->system_rhs(i);
+        }
+
+        field_residual_norms[f] = std::sqrt(sum_of_squares);
+
+        first += this->dofs_per_field[f];
+    }
+
+    this->telemetry.begin_record("iteration");
+    this->telemetry.add_value("stage", this->continuation_stage);
+    this->telemetry.add_value("step", this->time_step_counter);
+    this->telemetry.add_value("time", this->new_time);
+    this->telemetry.add_value("step_size", this->time_step_size);
+    this->telemetry.add_value("iteration", iteration);
+    this->telemetry.add_value("relative_correction", relative_correction);
+    this->telemetry.add_value("velocity_residual", field_residual_norms[0]);
+    this->telemetry.add_value("pressure_residual", field_residual_norms[1]);
+    this->telemetry.add_value("temperature_residual", field_residual_norms[2]);
+    this->telemetry.add_value("linear_iterations", this->linear_iteration_count);
+    this->telemetry.add_value("assembly_wall_time", this->assembly_wall_time);
+    this->telemetry.add_value("reassembled_cells", this->reassembled_cell_count);
+    this->telemetry.add_value("linear_solve_wall_time", this->linear_solve_wall_time);
+    this->telemetry.end_record();
+}
+
+/*! Write a telemetry record for the latest time step, including the current and peak resident memory of the process */
+template<int dim>
+void Phaseflow<dim>::write_step_telemetry(
+    const unsigned int nonlinear_iterations,
+    const unsigned int rejections,
+    const double wall_time)
+{
+    Utilities::System::MemoryStats memory_stats;
+
+    Utilities::System::get_memory_stats(memory_stats);
+
+    this->telemetry.begin_record("step");
+    this->telemetry.add_value("stage", this->continuation_stage);
+    this->telemetry.add_value("step", this->time_step_counter);
+    this->telemetry.add_value("time", this->time);
+    this->telemetry.add_value("step_size", this->time_step_size);
+    this->telemetry.add_value("nonlinear_iterations", nonlinear_iterations);
+    this->telemetry.add_value("rejections", rejections);
+    this->telemetry.add_value("wall_time", wall_time);
+    this->telemetry.add_value("memory_kB", memory_stats.VmRSS);
+    this->telemetry.add_value("peak_memory_kB", memory_stats.VmHWM);
+    this->telemetry.end_record();
+}
+
+/*! Write a telemetry record of the startup, i.e. the wall time of init, and the size of the initial system */
+template<int dim>
+void Phaseflow<dim>::write_startup_telemetry()
+{
+    this->telemetry.begin_record("startup");
+    this->telemetry.add_value("wall_time", this->startup_wall_time);
+    this->telemetry.add_value("active_cells", this->triangulation.n_active_cells());
+    this->telemetry.add_value("dofs", this->dof_handler.n_dofs());
+    this->telemetry.end_record();
+}
+
+#endif
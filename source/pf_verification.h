@@ -4,7 +4,9 @@
 template<int dim>
 void Phaseflow<dim>::append_verification_table()
 {
-    assert(this->params.verification.enabled);
+    TimerOutput::Scope timer_section(this->timer, "verification");
+    
+    AssertThrow(this->params.verification.enabled, ExcInternalError());
 
     Vector<float> difference_per_cell(triangulation.n_active_cells());
 
@@ -52,8 +54,8 @@ void Phaseflow<dim>::write_verification_table()
     this->verification_table.set_precision("L1_norm_error", precision);
     this->verification_table.set_scientific("L1_norm_error", true);
 
-    std::ofstream out_file(this->verification_table_file_name, std::fstream::app);
-    assert(out_file.good());
+    std::ofstream out_file(this->output_path(this->verification_table_file_name), std::fstream::app);
+    AssertThrow(out_file.good(), ExcIO());
     this->verification_table.write_text(out_file);
     out_file.close(); 
 }
@@ -15,6 +15,9 @@
  *  - Added a parameteric sphere-cylinder grid
  *  - Added a boundary grid refinement routine
  */
+#ifndef _phaseflow_h_
+#define _phaseflow_h_
+
 #include <deal.II/base/utilities.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/function.h>
@@ -27,6 +30,7 @@
 #include <deal.II/lac/solver_bicgstab.h>
 #include <deal.II/lac/solver_gmres.h>
 #include <deal.II/lac/precondition.h>
+#include <deal.II/lac/sparse_ilu.h>
 #include <deal.II/lac/constraint_matrix.h>
 #include <deal.II/grid/tria.h>
 #include <deal.II/grid/grid_generator.h>
@@ -46,9 +50,13 @@
 #include <deal.II/numerics/error_estimator.h>
 #include <deal.II/numerics/fe_field_function.h>
 #include <deal.II/base/table_handler.h>
+#include <deal.II/base/timer.h>
 
 #include <iostream>
 #include <functional>
+#include <cmath>
+#include <iomanip>
+#include <memory>
 
 #include <assert.h> 
 #include <deal.II/grid/manifold_lib.h>
@@ -58,51 +66,123 @@
 
 #include "my_grid_generator.h"
 #include "output.h"
+#include "my_vector_tools.h"
+#include "anderson_acceleration.h"
+#include "block_multigrid_preconditioner.h"
+#include "telemetry_stream.h"
+#include "cell_values_cache.h"
 
 #include "pf_parameters.h"
 
+#include "grid_cache.h"
+
 #include "pf_global_parameters.h"
 
+#include "pf_local_assembly.h"
+
 namespace Phaseflow
 {
   using namespace dealii;
+  
+  /*! Summary of a run, e.g. for the batch runner */
+  struct RunSummary
+  {
+    types::global_dof_index dofs;
+    unsigned int time_steps;
+    unsigned int nonlinear_iterations;
+    double time;
+    bool converged;
+  };
     
   template<int dim>
   class Phaseflow
   {
   public:
   
-    Phaseflow();
+    /*! The progress messages and summaries are written to out, e.g. a log file of each case of a batch run */
+    Phaseflow(std::ostream &_out = std::cout);
     Parameters::StructuredParameters params;
-    void init(std::string file_path);
+    void init(const std::string parameter_file = "");
     void run(const std::string parameter_file = "");
+    RunSummary get_run_summary() const;
 
   private:
+  
+    /*! Each model has its own stream, so that concurrent models never share the format state of std::cout */
+    std::ostream &out;
+    
+    /*! The microbenchmarks time the private assembly and solver methods in isolation */
+    template<int> friend class Benchmark;
 
     void create_coarse_grid();
     
     void setup_system();
     
+    void renumber_dofs();
+    
+    void report_sparsity_statistics() const;
+    
+    void setup_block_multigrid_preconditioner();
+    
     void assemble_system();
     
+    void assemble_linear_terms(const LocalAssembly::Coefficients<dim> &coefficients);
+    
+    LocalAssembly::Coefficients<dim> get_coefficients() const;
+    
     void interpolate_boundary_values(
         Function<dim>* function,
         std::map<types::global_dof_index, double> &boundary_values) const;
     
+    void get_residual_boundary_values(std::map<types::global_dof_index, double> &residual_boundary_values);
+    
     void apply_boundary_values_and_constraints();
     
     void solve_linear_system();
     
+    void solve_linear_system_with_mixed_precision();
+    
+    void update_forcing_term();
+    
     void step_newton();
     
+    struct Subsystem;
+    
+    void setup_segregated_subsystems();
+    
+    void assemble_subsystem(Subsystem &subsystem);
+    
+    void apply_boundary_values_to_subsystem(
+        Subsystem &subsystem,
+        const std::map<types::global_dof_index, double> &residual_boundary_values);
+    
+    void solve_subsystem(Subsystem &subsystem);
+    
+    double step_segregated();
+    
     bool solve_nonlinear_problem();
     
+    bool solve_steady_problem();
+    
+    bool solve_problem();
+    
+    bool run_continuation();
+    
     void set_time_step_size(double new_size);
     
+    void get_time_derivative_coefficients(double &alpha_0, double &alpha_1, double &alpha_2) const;
+    
+    double estimate_time_error(unsigned int &order) const;
+    
     void step_time();
 
     void write_solution();
+    
+    std::string output_path(const std::string file_name) const;
 
+    /*! Declared before the triangulation, which refers to it, so that it is destroyed after the triangulation */
+    SphericalManifold<dim> spherical_manifold;
+    
     Triangulation<dim> triangulation;
 
     FESystem<dim,dim> fe;
@@ -120,25 +200,118 @@ namespace Phaseflow
     SparsityPattern sparsity_pattern;
 
     SparseMatrix<double> system_matrix;
+    
+    /*! Single precision copy of the system matrix, only allocated for the mixed precision solver */
+    SparseMatrix<float> single_precision_matrix;
+    
+    /*! The terms of the Jacobian which do not depend on the Newton iterate, only allocated if they are precomputed */
+    SparseMatrix<double> mass_matrix;
+    
+    SparseMatrix<double> linear_terms_matrix;
+    
+    /*! Coefficients with which the linear terms were assembled, or null if they must be reassembled */
+    std::unique_ptr<LocalAssembly::Coefficients<dim>> linear_terms_coefficients;
+    
+    /*! The grid cache entry from which the initial setup is restored, or null */
+    std::shared_ptr<const GridCache::Entry> cached_setup;
+    
+    /*! The grid cache entry in which the initial setup is recorded, or null */
+    std::shared_ptr<GridCache::Entry> recorded_setup;
+    
+    /*! Empty unless the cell values are cached, and they fit within the memory limit */
+    LocalAssembly::CellValuesCache<dim> cell_values_cache;
+    
+    /*! Local matrices of the incremental assembly, indexed by the active cell index, and the local iterates with which they were assembled */
+    std::vector<FullMatrix<double>> cached_local_matrices;
+    
+    std::vector<Vector<double>> cached_local_iterates;
+    
+    /*! Coefficients with which the cached local matrices were assembled, or null if there are none */
+    std::unique_ptr<LocalAssembly::Coefficients<dim>> cached_local_matrices_coefficients;
+    
+    /*! The Jacobian is assembled incrementally if requested, and if its cache fits within the memory limit */
+    bool incremental_jacobian = false;
+    
+    /*! Memory in bytes of the cached local matrices and iterates once every cell is cached, or zero */
+    std::size_t local_matrices_cache_memory = 0;
 
+    /*! This is also the iterate of the nonlinear solvers, which restore it from old_solution if they fail. */
     Vector<double> solution;
     
     Vector<double> newton_residual;
     
-    Vector<double> newton_solution;
-    
     Vector<double> old_solution;
     
-    Vector<double> old_newton_solution;
+    /*! Only allocated for BDF2 or error control */
+    Vector<double> old_old_solution;
+    
+    /*! Only allocated for BDF2 with error control, for the third order error estimate */
+    Vector<double> old_old_old_solution;
 
     Vector<double> system_rhs;
     
+    /*! Relative tolerance for the next iterative linear solve, i.e. the inexact Newton forcing term */
+    double linear_solver_tolerance;
+    
+    /*! Norms of the Newton linearized system's right hand side at the current and previous Newton iterates */
+    double nonlinear_residual_norm;
+    
+    double old_nonlinear_residual_norm;
+    
+    /*! Assemble the Oseen (Picard) linearization instead of the Newton linearization */
+    bool use_picard_linearization = false;
+    
+    /*! Only constructed when GMRES is preconditioned with multigrid */
+    std::unique_ptr<LinearSolvers::BlockMultigridPreconditioner<dim>> block_multigrid_preconditioner;
+    
+    /*!
+    @brief A diagonal block of the system, which the segregated iterations assemble and solve on its own.
+    
+    @detail
+    
+        After the component-wise renumbering, the DoFs of the subsystem are the contiguous range
+        from first_dof, so that the global DoF i is the row i - first_dof of the subsystem.
+    */
+    struct Subsystem
+    {
+        std::string name;
+        
+        types::global_dof_index first_dof;
+        
+        types::global_dof_index n_dofs;
+        
+        /*! The local indices of the subsystem's DoFs on each cell */
+        std::vector<unsigned int> cell_dofs;
+        
+        SparsityPattern sparsity_pattern;
+        
+        SparseMatrix<double> matrix;
+        
+        Vector<double> rhs;
+        
+        Vector<double> correction;
+        
+        /*! Inexact Newton history of the subsystem */
+        double residual_norm;
+        
+        double linear_solver_tolerance;
+    };
+    
+    /*! The flow (velocity and pressure) and energy (temperature) subsystems, only set up for segregated iterations */
+    Subsystem subsystems[2];
+    
     double time;
     
     double new_time;
     
     double time_step_size;
     
+    /*! Size of the previous time step, or zero if there is no time step history */
+    double old_time_step_size = 0.;
+    
+    /*! Size of the time step before the previous time step, or zero */
+    double old_old_time_step_size = 0.;
+    
     unsigned int time_step_counter;
 
     unsigned int boundary_count;
@@ -161,15 +334,75 @@ namespace Phaseflow
     
     void write_verification_table();
     
+    void write_performance_report() const;
+    
+    void report_memory_consumption() const;
+    
+    void write_iteration_telemetry(const unsigned int iteration, const double relative_correction);
+    
+    void write_step_telemetry(const unsigned int nonlinear_iterations, const unsigned int rejections, const double wall_time);
+    
+    void write_startup_telemetry();
+    
     TableHandler verification_table;
     
     std::string verification_table_file_name = "verification_table.txt";
     
+    TableHandler pseudo_transient_history;
+    
+    /*! Counts the stages of parameter continuation, or zero if continuation is disabled */
+    unsigned int continuation_stage = 0;
+    
+    TableHandler continuation_table;
+    
+    /*! Wall times of the phases of the simulation. The summary is only printed if profiling is enabled. */
+    TimerOutput timer;
+    
+    /*! Number of iterations taken by the latest call of solve_nonlinear_problem */
+    unsigned int nonlinear_iteration_count = 0;
+    
+    struct StepStatistics
+    {
+        unsigned int stage;
+        unsigned int step;
+        double time;
+        double step_size;
+        unsigned int nonlinear_iterations;
+        unsigned int rejections;
+    };
+    
+    std::vector<StepStatistics> step_statistics;
+    
+    /*! Only open if telemetry is enabled */
+    Diagnostics::TelemetryStream telemetry;
+    
+    /*! Number of DoFs of each field, which are contiguous after the component-wise renumbering */
+    std::vector<types::global_dof_index> dofs_per_field;
+    
+    /*! Statistics of the latest linear system, for the telemetry */
+    unsigned int linear_iteration_count = 0;
+    
+    double assembly_wall_time = 0.;
+    
+    unsigned int reassembled_cell_count = 0;
+    
+    double linear_solve_wall_time = 0.;
+    
+    /*! Wall time of init, i.e. from reading the parameters to setting the initial values */
+    double startup_wall_time = 0.;
+    
+    /*! Whether the latest run solved its problem, or else every stage of its continuation */
+    bool run_converged = false;
+    
+    /*! Kept from reading the parameters until the used parameters are logged, which is deferred until after the startup */
+    std::unique_ptr<ParameterHandler> parameter_handler;
+    
   };
   
   template<int dim>
-  Phaseflow<dim>::Phaseflow()
+  Phaseflow<dim>::Phaseflow(std::ostream &_out)
     :
+    out(_out),
     fe(FE_Q<dim>(SCALAR_DEGREE + 1), dim, // velocity
        FE_Q<dim>(SCALAR_DEGREE), 1, // pressure
        FE_Q<dim>(SCALAR_DEGREE), 1), // temperature
@@ -180,30 +413,139 @@ namespace Phaseflow
     source_function(dim + 2),
     initial_values_function(dim + 2),
     boundary_function(dim + 2),
-    exact_solution_function(dim + 2)
+    exact_solution_function(dim + 2),
+    timer(_out, TimerOutput::never, TimerOutput::wall_times)
   {}
 
   #include "pf_system.h"
 
   #include "pf_solve_nonlinear_problem.h"
   
+  #include "pf_segregated.h"
+  
+  #include "pf_solve_steady_problem.h"
+  
+  #include "pf_continuation.h"
+  
   #include "pf_step_time.h"
   
   #include "pf_output.h"
   
   #include "pf_verification.h"
   
+  #include "pf_profiling.h"
+  
+  #include "pf_telemetry.h"
+  
   template<int dim>
-  void Phaseflow<dim>::run(const std::string parameter_file)
+  RunSummary Phaseflow<dim>::get_run_summary() const
   {
+    RunSummary summary = {this->dof_handler.n_dofs(), 0, 0, this->time, this->run_converged};
     
-    // Clean up the files in the working directory
+    for (auto step : this->step_statistics)
+    {
+        summary.time_steps++;
+        
+        summary.nonlinear_iterations += step.nonlinear_iterations;
+    }
+    
+    return summary;
+  }
+  
+  /*! Get the path of an output file in the parameterized output directory */
+  template<int dim>
+  std::string Phaseflow<dim>::output_path(const std::string file_name) const
+  {
+    return Parameters::output_path(this->params.output, file_name);
+  }
+  
+  /*! Solve the problem with the current parameters, starting from the current solution
+  
+  This either marches through time, or directly solves for the steady state with pseudo-transient continuation.
+  
+  Returns false if the steady state was not found, or if time stepping stopped before reaching the end time,
+  or, when stopping at steady state, if it ended without reaching steady state.
+  
+  */
+  template<int dim>
+  bool Phaseflow<dim>::solve_problem()
+  {
+    if (this->params.pseudo_transient.enabled)
+    {
+        const bool converged = this->solve_steady_problem();
+        
+        this->time_step_counter = 1;
+        
+        /* Do not write an unconverged iterate as if it were the steady state. */
+        if (converged)
+        {
+            this->write_solution();
+            
+            if (this->params.verification.enabled)
+            {
+                this->append_verification_table();
+            }
+        }
+        
+        return converged;
+    }
+    
+    auto reached_end_time = [this]()
+    {
+        return this->time > (this->params.time.end*(1. - this->params.time.epsilon) - this->params.time.epsilon);
+    };
+    
+    bool reached_steady_state = false;
+    
+    for (this->time_step_counter = 1; this->time_step_counter < this->params.time.max_steps; ++this->time_step_counter)
+    { 
+        if (reached_end_time())
+        {
+            break;
+        }
+        
+        this->step_time();
+        
+        this->write_solution();
 
-    if (this->params.verification.enabled)
+        if (this->params.verification.enabled)
+        {
+            this->append_verification_table();
+        }
+     
+        if (this->params.time.stop_when_steady)
+        {
+            double unsteadiness = MyVectorTools::l2_norm_of_difference(this->solution, this->old_solution)
+                /this->solution.l2_norm();
+            
+            this->out << "Unsteadiness, || w_{n+1} - w_n || / || w_{n+1} || = " << unsteadiness << std::endl;
+            
+            if (unsteadiness < this->params.time.steady_tolerance)
+            {
+                this->out << "Reached steady state." << std::endl;
+                
+                reached_steady_state = true;
+                
+                break;
+            }
+            
+        }
+
+    } 
+    
+    if (this->params.time.stop_when_steady)
     {
-        std::remove(this->verification_table_file_name.c_str());
+        return reached_steady_state;
     }
     
+    return reached_end_time();
+    
+  }
+  
+  /*! Read the parameters, create the grid, setup the system, and set the initial values */
+  template<int dim>
+  void Phaseflow<dim>::init(const std::string parameter_file)
+  {    
     /*
     Working with deal.II's Function class has been interesting, and I'm 
     sure many of my choices are unorthodox. The most important lesson learned has been that 
@@ -212,48 +554,123 @@ namespace Phaseflow
     actually being used.
     */
     
+    Timer startup_timer;
+    
+    this->parameter_handler.reset(new ParameterHandler());
+    
     this->params = Parameters::read<dim>(
+        *this->parameter_handler,
         parameter_file,
         this->source_function,
         this->initial_values_function,
         this->boundary_function,
         this->exact_solution_function);
     
-    MyGridGenerator::create_coarse_grid(
-        this->triangulation,
-        this->manifold_ids,
-        this->manifold_descriptors,
-        this->boundary_count,
-        this->params.geometry.grid_name,
-        params.geometry.sizes);
+    // Clean up the files in the output directory
+    
+    if (this->params.verification.enabled)
+    {
+        std::remove(this->output_path(this->verification_table_file_name).c_str());
+    }
+    
+    if (this->params.telemetry.enabled)
+    {
+        this->telemetry.open(this->output_path(this->params.telemetry.file_name));
+    }
+    
+    this->timer.enter_subsection("create grid");
+    
+    std::string grid_cache_key;
+    
+    if (this->params.grid_cache.enabled)
+    {
+        grid_cache_key = GridCache::make_key(this->params, this->fe.get_name());
+        
+        this->cached_setup = GridCache::find(this->params.grid_cache.directory, grid_cache_key);
+    }
+    
+    if (this->cached_setup)
+    {
+        this->out << "Restoring the grid, the DoF numbering and the sparsity pattern from the grid cache" << std::endl;
+        
+        this->boundary_count = this->cached_setup->boundary_count;
+        
+        this->manifold_ids = this->cached_setup->manifold_ids;
+        
+        this->manifold_descriptors = this->cached_setup->manifold_descriptors;
+        
+        this->cached_setup->load_triangulation(this->triangulation);
+    }
+    else
+    {
+        MyGridGenerator::create_coarse_grid(
+            this->triangulation,
+            this->manifold_ids,
+            this->manifold_descriptors,
+            this->boundary_count,
+            this->params.geometry.grid_name,
+            params.geometry.sizes);
+    }
     
     /* Attach manifolds for exact geometry 
     
     For now this only supports a single spherical manifold centered at the origin.
     
     */
-    SphericalManifold<dim> spherical_manifold;
-    
     for (unsigned int i = 0; i < this->manifold_ids.size(); i++)
     {
         if (this->manifold_descriptors[i] == "spherical")
         {
-            this->triangulation.set_manifold(this->manifold_ids[i], spherical_manifold);      
+            this->triangulation.set_manifold(this->manifold_ids[i], this->spherical_manifold);      
         }
     }
     
     // Run initial refinement cycles
     
-    this->triangulation.refine_global(this->params.refinement.initial_global_cycles);
+    if (!this->cached_setup)
+    {
+        this->triangulation.refine_global(this->params.refinement.initial_global_cycles);
+    }
+    
+    if (this->params.grid_cache.enabled && !this->cached_setup)
+    {
+        this->recorded_setup = std::make_shared<GridCache::Entry>();
+        
+        this->recorded_setup->key = grid_cache_key;
+        
+        this->recorded_setup->boundary_count = this->boundary_count;
+        
+        this->recorded_setup->manifold_ids = this->manifold_ids;
+        
+        this->recorded_setup->manifold_descriptors = this->manifold_descriptors;
+        
+        this->recorded_setup->save_triangulation(this->triangulation);
+    }
+    
+    this->timer.leave_subsection("create grid");
     
     // Initialize the linear system
     
     this->setup_system(); 
+    
+    if (this->recorded_setup)
+    {
+        GridCache::insert(this->params.grid_cache.directory, this->recorded_setup);
+    }
+    
+    /* Later setups, e.g. after adaptive refinement, neither use nor fill the cache. */
+    this->cached_setup.reset();
+    
+    this->recorded_setup.reset();
 
     this->time = 0.;
     
     this->set_time_step_size(this->params.time.initial_step_size);
     
+    this->old_time_step_size = 0.;
+    
+    this->old_old_time_step_size = 0.;
+    
     this->time_step_counter = 0;
     
     VectorTools::interpolate(
@@ -261,42 +678,36 @@ namespace Phaseflow
         this->initial_values_function,
         this->solution); 
     
+    this->startup_wall_time = startup_timer.wall_time();
+    
+    if (this->telemetry.is_open())
+    {
+        this->write_startup_telemetry();
+    }
+    
+  }
+  
+  template<int dim>
+  void Phaseflow<dim>::run(const std::string parameter_file)
+  {
+    this->timer.enter_subsection("run");
+    
+    this->init(parameter_file);
+    
+    Parameters::write_parameter_log(*this->parameter_handler, this->params.output);
+    
+    this->parameter_handler.reset();
+    
     this->write_solution();
     
-    for (this->time_step_counter = 1; this->time_step_counter < this->params.time.max_steps; ++this->time_step_counter)
-    { 
-        if (this->time > (this->params.time.end*(1. - EPSILON) - EPSILON))
-        {
-            break;
-        }
-        
-        this->step_time();
-        
-        this->write_solution();
-
-        if (this->params.verification.enabled)
-        {
-            this->append_verification_table();
-        }
-     
-        if (this->params.time.stop_when_steady)
-        {
-            Vector<double> time_residual = this->solution; // There is evidently no Vector<Number> - Vector<Number> method.
-            time_residual -= this->old_solution;
-            
-            double unsteadiness = time_residual.l2_norm()/this->solution.l2_norm();
-            
-            std::cout << "Unsteadiness, || w_{n+1} - w_n || / || w_{n+1} || = " << unsteadiness << std::endl;
-            
-            if (unsteadiness < this->params.time.steady_tolerance)
-            {
-                std::cout << "Reached steady state." << std::endl;
-                break;
-            }
-            
-        }
-
-    } 
+    if (this->params.continuation.parameter == "none")
+    {
+        this->run_converged = this->solve_problem();
+    }
+    else
+    {
+        this->run_converged = this->run_continuation();
+    }
     
     /* Clean up. 
     
@@ -305,6 +716,22 @@ namespace Phaseflow
     */
     this->triangulation.set_manifold(0);
     
+    this->timer.leave_subsection("run");
+    
+    if (this->params.profiling.enabled)
+    {
+        this->timer.print_summary();
+        
+        this->write_performance_report();
+    }
+    
+    /* Without continuation, there is nothing left to try if the steady state was not found.
+    The continuation driver instead reports its failed stage, and time stepping reports through the run summary. */
+    AssertThrow(this->run_converged || !this->params.pseudo_transient.enabled || (this->params.continuation.parameter != "none"),
+        ExcMessage("Pseudo-transient continuation did not converge."));
+    
   }
   
 }
+
+#endif
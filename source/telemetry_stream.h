@@ -0,0 +1,108 @@
+#ifndef _telemetry_stream_h_
+#define _telemetry_stream_h_
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace Diagnostics
+{
+    /*!
+    @brief Buffered writer of JSON-lines records, i.e. one JSON object per line.
+
+    @detail
+
+        Records are composed in memory and only written to the file when the buffer is full,
+        and when the stream is destroyed, so that leaving the stream enabled costs little
+        more than formatting the numbers.
+
+        Nothing is written unless the stream has been opened.
+    */
+    class TelemetryStream
+    {
+    public:
+
+        ~TelemetryStream()
+        {
+            this->flush();
+        }
+
+        void open(const std::string &file_name, const std::streamoff _buffer_size = 1 << 16)
+        {
+            this->file.open(file_name);
+
+            this->buffer_size = _buffer_size;
+
+            this->buffer << std::setprecision(10);
+        }
+
+        bool is_open() const
+        {
+            return this->file.is_open();
+        }
+
+        /*! Begin a record with its type, e.g. "iteration" or "step" */
+        void begin_record(const std::string &type)
+        {
+            this->buffer << "{\"type\": \"" << type << "\"";
+        }
+
+        template<typename ValueType>
+        void add_value(const std::string &key, const ValueType value)
+        {
+            this->buffer << ", \"" << key << "\": " << value;
+        }
+
+        /*! JSON has no representation of infinity or NaN */
+        void add_value(const std::string &key, const double value)
+        {
+            this->buffer << ", \"" << key << "\": ";
+
+            if (std::isfinite(value))
+            {
+                this->buffer << value;
+            }
+            else
+            {
+                this->buffer << "null";
+            }
+        }
+
+        void end_record()
+        {
+            this->buffer << "}\n";
+
+            if (this->buffer.tellp() > this->buffer_size)
+            {
+                this->flush();
+            }
+        }
+
+        void flush()
+        {
+            if (!this->file.is_open())
+            {
+                return;
+            }
+
+            this->file << this->buffer.str();
+
+            this->file.flush();
+
+            this->buffer.str("");
+        }
+
+    private:
+
+        std::ofstream file;
+
+        std::ostringstream buffer;
+
+        std::streamoff buffer_size = 0;
+    };
+
+}
+
+#endif
@@ -0,0 +1,193 @@
+/*!
+@brief Time the assembly, the boundary conditions and the linear solve of Phaseflow in isolation.
+
+@detail
+
+    The model is set up once from a parameter file, and its initial values are used as the state.
+    Each kernel is then repeated, and the minimum and median wall times are reported
+    for each requested thread limit, to evaluate kernel optimizations and thread scaling.
+
+    Usage:
+
+        phaseflow_microbenchmarks input.prm [repetitions] [thread limits ...]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+#include <deal.II/base/multithread_info.h>
+
+#include "phaseflow.h"
+
+namespace Phaseflow
+{
+    template<int dim>
+    class Benchmark
+    {
+    public:
+
+        Benchmark(const std::string parameter_file)
+        {
+            this->model.init(parameter_file);
+
+            this->model.new_time = this->model.time + this->model.time_step_size;
+
+            this->model.old_solution = this->model.solution;
+
+            this->model.old_old_solution = this->model.solution;
+
+            this->model.linear_solver_tolerance = this->model.params.linear_solver.tolerance;
+        }
+
+        ~Benchmark()
+        {
+            this->model.triangulation.set_manifold(0);
+        }
+
+        void run(const unsigned int repetitions, const unsigned int threads)
+        {
+            MultithreadInfo::set_thread_limit(threads);
+
+            this->report("assemble system", threads, repetitions, [this]()
+            {
+                this->model.assemble_system();
+            });
+
+            this->report("apply boundary values and constraints", threads, repetitions, [this]()
+            {
+                this->model.apply_boundary_values_and_constraints();
+            });
+
+            this->report("solve linear system", threads, repetitions, [this]()
+            {
+                this->model.newton_residual = 0.;
+
+                this->model.solve_linear_system();
+            });
+        }
+
+        unsigned int n_dofs() const
+        {
+            return this->model.dof_handler.n_dofs();
+        }
+
+    private:
+
+        template<typename Kernel>
+        void report(
+            const std::string name,
+            const unsigned int threads,
+            const unsigned int repetitions,
+            Kernel kernel)
+        {
+            std::vector<double> wall_times;
+
+            /* Silence the model's progress messages while timing. */
+            std::ostringstream silenced;
+
+            std::streambuf *cout_buffer = std::cout.rdbuf(silenced.rdbuf());
+
+            for (unsigned int r = 0; r < repetitions; ++r)
+            {
+                const auto start = std::chrono::steady_clock::now();
+
+                kernel();
+
+                const std::chrono::duration<double> wall_time = std::chrono::steady_clock::now() - start;
+
+                wall_times.push_back(wall_time.count());
+
+                silenced.str("");
+            }
+
+            std::cout.rdbuf(cout_buffer);
+
+            std::sort(wall_times.begin(), wall_times.end());
+
+            std::cout << std::left << std::setw(40) << name << std::right
+                << std::setw(8) << threads
+                << std::setw(14) << wall_times.front()
+                << std::setw(14) << wall_times[wall_times.size()/2]
+                << std::setw(14) << this->n_dofs()/wall_times.front() << std::endl;
+        }
+
+        Phaseflow<dim> model;
+    };
+
+    template<int dim>
+    void run_benchmarks(
+        const std::string parameter_file,
+        const unsigned int repetitions,
+        const std::vector<unsigned int> thread_limits)
+    {
+        Benchmark<dim> benchmark(parameter_file);
+
+        std::cout << "Number of degrees of freedom: " << benchmark.n_dofs() << std::endl << std::endl
+            << std::left << std::setw(40) << "kernel" << std::right
+            << std::setw(8) << "threads"
+            << std::setw(14) << "min [s]"
+            << std::setw(14) << "median [s]"
+            << std::setw(14) << "DoFs/s" << std::endl;
+
+        for (auto threads : thread_limits)
+        {
+            benchmark.run(repetitions, threads);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc < 2)
+        {
+            std::cerr << "Usage: " << argv[0] << " input.prm [repetitions] [thread limits ...]" << std::endl;
+
+            return 1;
+        }
+
+        const std::string parameter_file = argv[1];
+
+        const unsigned int repetitions = (argc > 2) ? std::atoi(argv[2]) : 10;
+
+        std::vector<unsigned int> thread_limits;
+
+        for (int i = 3; i < argc; ++i)
+        {
+            thread_limits.push_back(std::atoi(argv[i]));
+        }
+
+        if (thread_limits.empty())
+        {
+            thread_limits.push_back(dealii::MultithreadInfo::n_threads());
+        }
+
+        const Phaseflow::Parameters::Meta mp = Phaseflow::Parameters::read_meta_parameters(parameter_file);
+
+        switch (mp.dim)
+        {
+            case 2:
+                Phaseflow::run_benchmarks<2>(parameter_file, repetitions, thread_limits);
+                break;
+
+            case 3:
+                Phaseflow::run_benchmarks<3>(parameter_file, repetitions, thread_limits);
+                break;
+
+            default:
+                Assert(false, dealii::ExcNotImplemented());
+                break;
+        }
+    }
+    catch (std::exception &exc)
+    {
+        std::cerr << std::endl << "Exception: " << exc.what() << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
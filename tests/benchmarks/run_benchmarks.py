@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+"""Run the performance benchmarks and compare them against a stored baseline.
+
+Each case is a parameter file which is run at several initial_global_cycles,
+with profiling enabled and solution output disabled. The throughputs are computed
+from the performance report which Phaseflow writes when profiling is enabled:
+
+    assembly:  DoFs assembled per second of assemble_system
+    solve:     DoFs solved per second of solve_linear_system
+    total:     DoFs times nonlinear iterations per second of the whole run
+
+A throughput which falls below the baseline by more than the tolerance is a regression,
+in which case this exits with a nonzero status.
+
+With --compare-coupling, this instead runs the COUPLING_CASES with monolithic and with segregated
+coupling, and prints the wall time per call of the monolithic assembly and linear solve
+next to those of the flow and energy subsystems.
+
+With --multigrid-iterations, this instead runs the MULTIGRID_CASES with GMRES preconditioned
+by ILU and by block multigrid, and prints the GMRES iterations per linear solve for each refinement,
+which should stay bounded for multigrid.
+
+Usage:
+
+    run_benchmarks.py --executable ./phaseflow --baseline baseline.json [--record] [--tolerance 0.2]
+
+    run_benchmarks.py --executable ./phaseflow --compare-coupling
+
+    run_benchmarks.py --executable ./phaseflow --multigrid-iterations
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+
+BENCHMARKS_DIR = os.path.dirname(os.path.abspath(__file__))
+
+TESTS_DIR = os.path.dirname(BENCHMARKS_DIR)
+
+CASES = [
+    ("lid_driven_cavity", os.path.join(TESTS_DIR, "lid_driven_cavity.prm"), [3, 4, 5, 6]),
+    ("natural_convection_air", os.path.join(TESTS_DIR, "natural_convection_air.prm"), [3, 4, 5, 6]),
+    ("natural_convection_shell_3d", os.path.join(BENCHMARKS_DIR, "natural_convection_shell_3d.prm"), [0, 1, 2]),
+]
+
+METRICS = ["assembly_throughput", "solve_throughput", "total_throughput"]
+
+COUPLING_CASES = [
+    ("natural_convection_air", os.path.join(TESTS_DIR, "natural_convection_air.prm"), [3, 4, 5]),
+]
+
+COUPLING_OVERRIDES = """
+subsection nonlinear_solver
+    set coupling = {coupling}
+end
+"""
+
+# The profiling sections of the assembly and the linear solve, for each coupling
+COUPLING_SECTIONS = {
+    "monolithic": [("system", "assemble system", "solve linear system")],
+    "segregated": [
+        ("flow", "assemble flow subsystem", "solve flow subsystem"),
+        ("energy", "assemble energy subsystem", "solve energy subsystem")],
+}
+
+# ParameterHandler applies the entries in order, so these override the entries of the case.
+OVERRIDES = """
+subsection refinement
+    set initial_global_cycles = {cycles}
+end
+
+subsection time
+    set max_steps = 2
+end
+
+subsection output
+    set write_solution_vtk = false
+    set write_linear_system = false
+end
+
+subsection profiling
+    set enabled = true
+    set report_file = performance_report.json
+end
+"""
+
+
+MULTIGRID_CASES = [
+    ("lid_driven_cavity", os.path.join(TESTS_DIR, "lid_driven_cavity.prm"), [3, 4, 5]),
+    ("natural_convection_air", os.path.join(TESTS_DIR, "natural_convection_air.prm"), [3, 4, 5]),
+]
+
+MULTIGRID_OVERRIDES = """
+subsection linear_solver
+    set method = GMRES
+    set preconditioner = {preconditioner}
+end
+"""
+
+GMRES_ITERATIONS = re.compile(r"Solved linear system with (\d+) GMRES iterations")
+
+
+def run_report(executable, name, parameter_file, cycles, extra_overrides=""):
+
+    run_dir = os.path.join(os.getcwd(), name)
+
+    os.makedirs(run_dir, exist_ok=True)
+
+    with open(parameter_file) as f:
+        parameters = f.read()
+
+    run_parameter_file = os.path.join(run_dir, "benchmark.prm")
+
+    with open(run_parameter_file, "w") as f:
+        f.write(parameters + OVERRIDES.format(cycles=cycles) + extra_overrides)
+
+    with open(os.path.join(run_dir, "stdout.txt"), "w") as log:
+        subprocess.check_call([executable, run_parameter_file], cwd=run_dir, stdout=log)
+
+    with open(os.path.join(run_dir, "performance_report.json")) as f:
+        return json.load(f)
+
+
+def run_case(executable, name, parameter_file, cycles):
+
+    report = run_report(executable, "{}-{}".format(name, cycles), parameter_file, cycles)
+
+    sections = report["sections"]
+
+    dofs = report["dofs"]
+
+    def throughput(section, calls_section=None):
+
+        calls = sections[calls_section or section]["calls"]
+
+        return dofs*calls/sections[section]["wall_time"]
+
+    return {
+        "dofs": dofs,
+        "assembly_throughput": throughput("assemble system"),
+        "solve_throughput": throughput("solve linear system"),
+        "total_throughput": throughput("run", "step newton"),
+    }
+
+
+def compare_coupling(executable):
+
+    print("{:36s} {:>10s} {:>10s} {:>8s} {:>14s} {:>14s}".format(
+        "case-cycles-coupling", "block", "DoFs", "calls", "assemble (s)", "solve (s)"))
+
+    for name, parameter_file, cycle_list in COUPLING_CASES:
+
+        for cycles in cycle_list:
+
+            for coupling, blocks in sorted(COUPLING_SECTIONS.items()):
+
+                key = "{}-{}-{}".format(name, cycles, coupling)
+
+                report = run_report(executable, key, parameter_file, cycles,
+                    COUPLING_OVERRIDES.format(coupling=coupling))
+
+                sections = report["sections"]
+
+                for block, assemble_section, solve_section in blocks:
+
+                    calls = sections[solve_section]["calls"]
+
+                    print("{:36s} {:>10s} {:>10d} {:>8d} {:>14.4g} {:>14.4g}".format(
+                        key, block, report["dofs"], calls,
+                        sections[assemble_section]["wall_time"]/calls,
+                        sections[solve_section]["wall_time"]/calls))
+
+    return 0
+
+
+def print_multigrid_iterations(executable):
+
+    print("{:36s} {:>16s} {:>10s} {:>8s} {:>6s} {:>6s} {:>6s}".format(
+        "case-cycles", "preconditioner", "DoFs", "solves", "min", "mean", "max"))
+
+    for name, parameter_file, cycle_list in MULTIGRID_CASES:
+
+        for preconditioner in ["ILU", "block_multigrid"]:
+
+            for cycles in cycle_list:
+
+                key = "{}-{}-{}".format(name, cycles, preconditioner)
+
+                report = run_report(executable, key, parameter_file, cycles,
+                    MULTIGRID_OVERRIDES.format(preconditioner=preconditioner))
+
+                with open(os.path.join(os.getcwd(), key, "stdout.txt")) as f:
+                    iterations = [int(count) for count in GMRES_ITERATIONS.findall(f.read())]
+
+                print("{:36s} {:>16s} {:>10d} {:>8d} {:>6d} {:>6.1f} {:>6d}".format(
+                    "{}-{}".format(name, cycles), preconditioner, report["dofs"], len(iterations),
+                    min(iterations), sum(iterations)/len(iterations), max(iterations)))
+
+    return 0
+
+
+def main():
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+
+    parser.add_argument("--executable", required=True)
+
+    parser.add_argument("--baseline", default=os.path.join(BENCHMARKS_DIR, "baseline.json"))
+
+    parser.add_argument("--record", action="store_true", help="Write the results as the new baseline.")
+
+    parser.add_argument("--tolerance", type=float, default=0.2,
+        help="Allowed relative decrease of each throughput.")
+
+    parser.add_argument("--cases", nargs="*", help="Only run these cases.")
+
+    parser.add_argument("--compare-coupling", action="store_true",
+        help="Compare the cost per call of the monolithic and the segregated sub-solves.")
+
+    parser.add_argument("--multigrid-iterations", action="store_true",
+        help="Print the GMRES iterations per solve with ILU and block multigrid preconditioning for several refinements.")
+
+    args = parser.parse_args()
+
+    executable = os.path.abspath(args.executable)
+
+    if args.compare_coupling:
+
+        return compare_coupling(executable)
+
+    if args.multigrid_iterations:
+
+        return print_multigrid_iterations(executable)
+
+    results = {}
+
+    print("{:36s} {:>15s}".format("case-cycles", "")
+        + "".join(" {:>12s}".format(metric.split("_")[0]) for metric in METRICS) + "  (DoFs/s)")
+
+    for name, parameter_file, cycle_list in CASES:
+
+        if args.cases and (name not in args.cases):
+            continue
+
+        for cycles in cycle_list:
+
+            key = "{}-{}".format(name, cycles)
+
+            results[key] = run_case(executable, name, parameter_file, cycles)
+
+            print("{:36s} {:>10d} DoFs".format(key, results[key]["dofs"])
+                + "".join(" {:>12.4g}".format(results[key][metric]) for metric in METRICS))
+
+    with open("benchmark_results.json", "w") as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+
+    if args.record:
+
+        with open(args.baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+        print("Recorded baseline " + args.baseline)
+
+        return 0
+
+    if not os.path.exists(args.baseline):
+
+        print("No baseline at {}; run with --record to create it.".format(args.baseline))
+
+        return 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    regressions = []
+
+    for key, result in sorted(results.items()):
+
+        if key not in baseline:
+            continue
+
+        for metric in METRICS:
+
+            ratio = result[metric]/baseline[key][metric]
+
+            if ratio < 1. - args.tolerance:
+                regressions.append("{} {}: {:.3g} of baseline".format(key, metric, ratio))
+
+    for regression in regressions:
+        print("Regression: " + regression)
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+
+    sys.exit(main())